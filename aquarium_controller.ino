@@ -7,7 +7,6 @@
 #include <Wire.h>
 #include <PCF8574.h>
 #include <OneWire.h>
-#include <DallasTemperature.h>
 #include <RTClib.h>
 #include <IRremote.hpp>
 #include <WiFi.h>
@@ -22,13 +21,21 @@ unsigned long bootTime = 0;
 // Include all module headers
 #include "config.h"
 #include "pin_definitions.h"
+#include "trace.h"
 #include "relays.h"
 #include "alarms.h"
+#include "faults.h"
+#include "tank.h"
 #include "temperature.h"
 #include "ato.h"
+#include "ato_stats.h"
+#include "ir_link.h"
 #include "lighting.h"
 #include "buttons.h"
+#include "watchdog.h"
+#include "idle.h"
 #include "display.h"
+#include "console.h"
 
 // ═══════════════════════════════════════════════════════════════
 // GLOBAL OBJECTS
@@ -37,10 +44,9 @@ unsigned long bootTime = 0;
 PCF8574 buttonBox(BUTTON_BOX_ADDR);
 PCF8574 relayBox(RELAY_BOX_ADDR);
 
-OneWire oneWireSump(TEMP_SUMP_PIN);
-OneWire oneWireDisplay(TEMP_DISPLAY_PIN);
-DallasTemperature sensorSump(&oneWireSump);
-DallasTemperature sensorDisplay(&oneWireDisplay);
+// One OneWire bus per TEMP_BUS_* (pin_definitions.h); any number of
+// DS18B20s can share a bus
+OneWire tempBuses[TEMP_BUS_COUNT] = { OneWire(TEMP_SUMP_PIN), OneWire(TEMP_DISPLAY_PIN) };
 
 RTC_DS3231 rtc;
 
@@ -52,70 +58,34 @@ DebouncedButton btnGreen(&buttonBox, BTN_GREEN);
 // ═══════════════════════════════════════════════════════════════
 // GLOBAL STATE VARIABLES
 // ═══════════════════════════════════════════════════════════════
-
-// Temperature
-float tempSump = 0;
-float tempDisplay = 0;
-bool heaterPrimaryOn = false;
-bool heaterBackupOn = false;
+// Per-tank state (temperatures, ATO, modes, lighting, clouds) lives in
+// the TankController instances (tank.h)
 
 // System modes
 bool emergencyStop = false;
-bool feedModeActive = false;
-bool photoModeActive = false;
 bool alarmSilenced = false;
 bool manualEstopLatched = false;
 bool developerModeEnabled = false;
 
-// ATO
-unsigned long atoStartTime = 0;
-unsigned long atoLastRunTime = 0;
-bool atoRunning = false;
-bool atoTimeoutAlarm = false;
-bool atoReservoirAlarm = false;
-
-// Feed mode
-unsigned long feedModeStartTime = 0;
+// Scheduler
+unsigned long lastTickTime = 0;
 
 // Relays and LEDs
 uint8_t relayStates = 0xFF;
 
-// Lighting
-LightMode currentLightMode = NIGHT_MODE;
-bool scheduledLightsEnabled = true;
-bool lightsOn = false;
-unsigned long rampStartTime = 0;
-int currentRampStep = 0;
-
-// Clouds
-CloudState cloudState = NO_CLOUD;
-unsigned long nextCloudTime = 0;
-unsigned long cloudStartTime = 0;
-unsigned long cloudDuration = 0;
-int cloudDimSteps = 0;
-int cloudBrightenSteps = 0;
-unsigned long lastCloudStepTime = 0;
-
 // ─────────────────────────────────────────────
 // Safety / Fault model
 // ─────────────────────────────────────────────
 
 bool hasActiveCriticalFaults() {
-  // Critical faults that should block manual override (unless dev mode)
-  bool overTemp = (tempSump >= TEMP_EMERGENCY_HIGH) || (tempDisplay >= TEMP_EMERGENCY_HIGH);
-  return overTemp || atoTimeoutAlarm || atoReservoirAlarm;
+  // Board faults flagged blocksOverride in FAULT_TABLE (unless dev mode)
+  return (faultBoard.active & FAULT_BLOCKS_OVERRIDE_MASK) != 0;
 }
 
-// Gyre wiring choice: set true if outlet is wired NC (recommended)
-constexpr bool GYRE_WIRED_NC = CFG_GYRE_WIRED_NC;
-
-// Intent-based gyre control (so you don't invert logic everywhere)
-void setGyreRunning(bool run) {
-  if (GYRE_WIRED_NC) {
-    setRelay(RELAY_GYRE, !run);   // relay ON cuts power, relay OFF allows power through NC
-  } else {
-    setRelay(RELAY_GYRE, run);    // relay ON provides power via NO
-  }
+// Same, for the faults a tank owns: they hold only that tank stopped
+bool tankOverrideBlocked(const TankController& t) {
+  if (developerModeEnabled) return false;
+  return (t.faults.active & FAULT_BLOCKS_OVERRIDE_MASK) != 0;
 }
 
 // One place that actually performs the "stop outputs" behavior.
@@ -130,20 +100,16 @@ void enterEstopState() {
   Serial.println("   EMERGENCY STOP ACTIVATED");
   Serial.println("   ═══════════════════════════════");
 
-  setRelay(RELAY_RETURN_PUMP, false);
-  setRelay(RELAY_HEATER_PRIMARY, false);
-  setRelay(RELAY_HEATER_BACKUP, false);
-  setRelay(RELAY_ATO_PUMP, false);
-
-  setNightMode();
+  // Every tank: outputs off, lights to night, circulation kept running
+  // (a tank already fault-stopped is there)
+  for (uint8_t i = 0; i < tankCount; i++) {
+    if (!tanks[i].faultStop) tanks[i].enterEstop();
+  }
 
   Serial.println("   Return pump: OFF");
   Serial.println("   Heaters: OFF");
   Serial.println("   ATO: OFF");
   Serial.println("   Lights: NIGHT MODE");
-
-  // Keep circulation running during stop
-  setGyreRunning(true);
   Serial.println("   Gyre: ON (circulation)");
   Serial.println("   (Blue-hold + Red tap to override/reset)");
   Serial.println("   ═══════════════════════════════\n");
@@ -157,23 +123,44 @@ void triggerEmergencyStop() {
   enterEstopState();
 }
 
-// Fault-driven stop entry point (overtemp, etc.)
-void triggerFaultStop() {
+// Fault-driven stop entry point (overtemp, etc.). A board fault stops
+// everything; a tank's fault stops only that tank.
+void triggerFaultStop(FaultState& source) {
   // DO NOT set manualEstopLatched here
-  enterEstopState();
+  TankController* t = tankForFaults(source);
+  if (!t) {
+    enterEstopState();
+    return;
+  }
+  if (t->faultStop) return;
+
+  t->faultStop = true;
+  alarmSilenced = false; // new stop re-arms audible alarm
+
+  Serial.printf("\n🔴 %s: FAULT STOP (other tanks keep running)\n", t->cfg->name);
+  if (!emergencyStop) t->enterEstop();
+  Serial.println("   (Blue-hold + Red tap to override/reset)");
+
+  soundAlarm(5);
 }
 
-// Leaves stop state and restores a known-good RUN baseline
+// Leaves stop state and restores a known-good RUN baseline. A tank
+// whose own blocking fault is still active stays stopped.
 void exitEstopToRunDefaults() {
   emergencyStop = false;
   alarmSilenced = false;
 
   // Ensure modes don't keep things off
-  feedModeActive = false;
-  photoModeActive = false;
-
-  setRelay(RELAY_RETURN_PUMP, true);
-  setGyreRunning(true);
+  for (uint8_t i = 0; i < tankCount; i++) {
+    TankController& t = tanks[i];
+    if (t.faultStop && tankOverrideBlocked(t)) {
+      Serial.printf("🚫 %s: stays stopped (active fault)\n", t.cfg->name);
+      t.enterEstop();
+      continue;
+    }
+    t.faultStop = false;
+    t.runDefaults();
+  }
 
   Serial.println("✓ System resumed (RUN defaults)");
   tone(BUZZER_PIN, 2500, 120);
@@ -183,7 +170,12 @@ void exitEstopToRunDefaults() {
 
 // This is used by combo logic (fault-gated override)
 bool attemptOverrideEstop() {
-  if (hasActiveCriticalFaults() && !developerModeEnabled) {
+  // Blocked by a board fault, or when every stopped tank is held by its own
+  bool resumable = false;
+  for (uint8_t i = 0; i < tankCount; i++) {
+    if (tanks[i].stopped() && !tankOverrideBlocked(tanks[i])) resumable = true;
+  }
+  if ((hasActiveCriticalFaults() && !developerModeEnabled) || !resumable) {
     Serial.println("🚫 Override blocked: active fault present");
     tone(BUZZER_PIN, 400, 120); delay(140); tone(BUZZER_PIN, 400, 120);
     return false;
@@ -199,58 +191,18 @@ bool attemptOverrideEstop() {
 
 // Keeps your old name, but now it restores deterministically
 void resetEmergencyStop() {
-  if (!emergencyStop) return;
+  if (!tanksAnyStopped()) return;
   exitEstopToRunDefaults();
 }
 
-void toggleFeedMode() {
-  if (feedModeActive) {
-    feedModeActive = false;
-    setRelay(RELAY_RETURN_PUMP, true);
-    setGyreRunning(true);
-    Serial.println("🐟 Feed mode OFF (manual)");
-  } else {
-    feedModeActive = true;
-    feedModeStartTime = millis();
-    setRelay(RELAY_RETURN_PUMP, false);
-    setGyreRunning(false);
-    Serial.println("🐟 Feed mode ON (10 minutes)");
-    tone(BUZZER_PIN, 1500, 100);
-  }
-}
-
 void handleBlueRedCombo() {
-  if (emergencyStop) {
+  if (tanksAnyStopped()) {
     attemptOverrideEstop();
   } else {
     Serial.println("🔧 Reset combo pressed (normal mode) — no action configured");
   }
 }
 
-void handleFeedMode() {
-  if (feedModeActive) {
-    if (millis() - feedModeStartTime >= FEED_MODE_DURATION) {
-      feedModeActive = false;
-      setRelay(RELAY_RETURN_PUMP, true);
-      setGyreRunning(true);
-      Serial.println("🐟 Feed mode ended (timeout)");
-      tone(BUZZER_PIN, 2000, 100);
-      delay(150);
-      tone(BUZZER_PIN, 2000, 100);
-    }
-  }
-}
-
-void togglePhotoMode() {
-  photoModeActive = !photoModeActive;
-  
-  if (photoModeActive) {
-    lightsPhotoMode();
-  } else {
-    lightsNormalMode();
-  }
-}
-
 // ═══════════════════════════════════════════════════════════════
 // SETUP
 // ═══════════════════════════════════════════════════════════════
@@ -274,29 +226,44 @@ void setup() {
   if (booted) return;
   booted = true;
   Serial.begin(115200);
-  delay(1000);
+  traceBegin();
+
+  // Warm path: crash reset with a valid RTC snapshot (and not a restart loop).
+  // Restores state and skips the cosmetic parts of boot. Replaying a
+  // wrapped trace takes it too, seeded from the trace's keyframe.
+  bool seeded = traceKeyframePending();
+  bool warmBoot = seeded || watchdogCheckWarmBoot();
+
+  if (warmBoot) {
+    Serial.println("\n♻️  WARM RESTART - restoring controller state");
+    printResetDiagnostics();
+    bootTime = ctlMillis() - 30000;  // state is known-good, skip the settle window
+  } else {
+    delay(1000);
   
-  Serial.println("\n\n╔═══════════════════════════════════════╗");
-  Serial.println("║   AQUARIUM CONTROLLER v3.0            ║");
-  Serial.println("║   Modular Version                     ║");
-  Serial.println("╚═══════════════════════════════════════╝\n");
-  bootTime = millis();
+    Serial.println("\n\n╔═══════════════════════════════════════╗");
+    Serial.println("║   AQUARIUM CONTROLLER v3.0            ║");
+    Serial.println("║   Modular Version                     ║");
+    Serial.println("╚═══════════════════════════════════════╝\n");
+    printResetDiagnostics();
+    bootTime = ctlMillis();
   
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(WIFI_SSID, WIFI_PASS);
-
-  Serial.print("Connecting to WiFi");
-  unsigned long start = millis();
-  while (WiFi.status() != WL_CONNECTED && millis() - start < 8000) {
-  delay(500);
-  Serial.print(".");
-  }
-  Serial.println();
+    WiFi.mode(WIFI_STA);
+    WiFi.begin(WIFI_SSID, WIFI_PASS);
+
+    Serial.print("Connecting to WiFi");
+    unsigned long start = millis();
+    while (WiFi.status() != WL_CONNECTED && millis() - start < 8000) {
+    delay(500);
+    Serial.print(".");
+    }
+    Serial.println();
 
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("✓ WiFi connected");
-  } else {
-    Serial.println("⚠️ WiFi failed, continuing offline");
+    if (WiFi.status() == WL_CONNECTED) {
+      Serial.println("✓ WiFi connected");
+    } else {
+      Serial.println("⚠️ WiFi failed, continuing offline");
+    }
   }
 
 #include <time.h>
@@ -315,29 +282,28 @@ static const char* TZ = "MST7MDT,M3.2.0/2,M11.1.0/2"; // Utah, auto DST
   // Initialize IR
   IrSender.begin(IR_SEND_PIN);
   Serial.println("✓ IR transmitter initialized");
+  irLinkBegin();
   
   // Scan I2C
-  Serial.println("\n→ Scanning I2C devices:");
-  int deviceCount = 0;
-  for (byte addr = 0x20; addr <= 0x70; addr++) {
-    Wire.beginTransmission(addr);
-    if (Wire.endTransmission() == 0) {
-      Serial.print("  ✓ Found device at: 0x");
-      if (addr < 16) Serial.print("0");
-      Serial.println(addr, HEX);
-      deviceCount++;
+  if (!warmBoot) {
+    Serial.println("\n→ Scanning I2C devices:");
+    int deviceCount = 0;
+    for (byte addr = 0x20; addr <= 0x70; addr++) {
+      Wire.beginTransmission(addr);
+      if (Wire.endTransmission() == 0) {
+        Serial.print("  ✓ Found device at: 0x");
+        if (addr < 16) Serial.print("0");
+        Serial.println(addr, HEX);
+        deviceCount++;
+      }
     }
+    Serial.print("  Total devices found: ");
+    Serial.println(deviceCount);
+    // Clear all transient modes on boot
+    alarmSilenced = false;
+    manualEstopLatched = false;
+    emergencyStop = false;
   }
-  Serial.print("  Total devices found: ");
-  Serial.println(deviceCount);
-  // Clear all transient modes on boot
-  feedModeActive = false;
-  photoModeActive = false;
-  alarmSilenced = false;
-  manualEstopLatched = false;
-  emergencyStop = false;
-  setRelay(RELAY_RETURN_PUMP, true);
-  setGyreRunning(true);
   
   // Initialize buttons
   btnYellow.begin();
@@ -361,15 +327,16 @@ static const char* TZ = "MST7MDT,M3.2.0/2,M11.1.0/2"; // Utah, auto DST
   for (int i = 0; i < 8; i++) {
     relayBox.pinMode(i, OUTPUT);
   }
- // Initialize all relays OFF
-for (int i = 0; i < 8; i++) {
-  relayBox.digitalWrite(i, HIGH);  // Active-LOW = OFF
-}
+  // Initialize all relays OFF (warm boot restores them from the snapshot)
+  if (!warmBoot) {
+    for (int i = 0; i < 8; i++) {
+      relayBox.digitalWrite(i, HIGH);  // Active-LOW = OFF
+    }
+  }
   Serial.println("✓ Relays initialized");
   
   // Initialize sensors
-  sensorSump.begin();
-  sensorDisplay.begin();
+  tempBegin();
   Serial.println("✓ Temperature sensors initialized");
   
   // Initialize RTC
@@ -395,35 +362,44 @@ for (int i = 0; i < 8; i++) {
   
   // Initialize other GPIO
   pinMode(BUZZER_PIN, OUTPUT);
-  pinMode(IR_RECV_PIN, INPUT);
-  pinMode(ATO_FLOAT_LOW, INPUT_PULLUP);
-  pinMode(ATO_FLOAT_HIGH, INPUT_PULLUP);
-  pinMode(ATO_RESERVOIR_EMPTY, INPUT_PULLUP);
   pinMode(PH_PROBE_PIN, INPUT);
   digitalWrite(BUZZER_PIN, LOW);
   Serial.println("✓ GPIO pins configured");
+
+  // Tanks: probes, float pins, IR address, heater channels
+  for (uint8_t i = 0; i < TANK_CONFIG_COUNT; i++) {
+    tankAdd(TANK_CONFIGS[i]);
+  }
+  tempMapRoles();
+
+  // Hardware is up; the rest of setup is control logic. A keyframe was
+  // written at the end of a pass, so there is no boot pass to start.
+  if (seeded) {
+    traceRestoreKeyframe();
+  } else {
+    ctlBeginPass(0);
+  }
   
-  // Set initial light mode
+  if (warmBoot) {
+    if (!seeded) watchdogRestoreSnapshot();
+    energyBegin();
+    idleBegin();
+    watchdogBegin();
+    Serial.println("✓ Warm restart complete");
+    return;
+  }
+
+  // Set initial light mode, then RUN defaults (so we don't come up "all off")
   Serial.println("\n→ Setting initial light mode...");
-  setInitialLightingFromTime();
-  
-  // RUN defaults after boot (so we don't come up "all off")
   emergencyStop = false;
   manualEstopLatched = false;
   alarmSilenced = false;
-  feedModeActive = false;
-  photoModeActive = false;
-
-  setRelay(RELAY_RETURN_PUMP, true);
-  setGyreRunning(true);
-
-  // Initialize cloud timing
-  nextCloudTime = millis() + random(CLOUD_MIN_INTERVAL, CLOUD_MAX_INTERVAL);
+  for (uint8_t i = 0; i < tankCount; i++) tanks[i].start();
   
   Serial.println("\n=== SYSTEM CONFIG ===");
 Serial.printf("Gyre wired NC: %s\n", CFG_GYRE_WIRED_NC ? "YES" : "NO");
 Serial.printf("ATO floats active-low: %s\n", CFG_ATO_FLOAT_ACTIVE_LOW ? "YES" : "NO");
-Serial.printf("Schedule enabled: %s\n", scheduledLightsEnabled ? "YES" : "NO");
+Serial.printf("Tanks: %u (%u bytes each)\n", tankCount, (unsigned)sizeof(TankController));
 Serial.println("=====================\n");
 
   
@@ -439,32 +415,101 @@ Serial.println("=====================\n");
   tone(BUZZER_PIN, 3000, 150);
   
   delay(2000);
+
+  energyBegin();
+  idleBegin();
+  watchdogBegin();
 }
 
 // ═══════════════════════════════════════════════════════════════
 // MAIN LOOP
 // ═══════════════════════════════════════════════════════════════
 
-void loop() {
-  handleButtons();
-
- static uint32_t last500 = 0;
-  uint32_t now = millis();
-
-  if (now - last500 >= 500) {
-    last500 = now;
-
-    readTemperatures();
-    checkTemperatureDifferential();
-    checkEmergencyShutoff();
-    // Ignore emergency faults for first 30 seconds after boot
-      if (millis() - bootTime < 30000) return;
-    controlHeaters();
-    handleFeedMode();
-    handleATO();
-    handleLightingSchedule();
-    handleClouds();
-    updateLEDs();
-    printStatus();
+// Scheduled work, every TICK_INTERVAL
+void runTick() {
+  watchdogBeat(WDT_TASK_SENSORS);
+  tempService();
+  for (uint8_t i = 0; i < tankCount; i++) {
+    TankController& t = tanks[i];
+    t.readTemperatures();
+    t.checkTemperatureDifferential();
+    t.checkEmergencyShutoff();
+  }
+  watchdogBeat(WDT_TASK_FAULTS);
+  evaluateFaults();
+  // Ignore emergency faults for first 30 seconds after boot
+  if (ctlMillis() - bootTime < 30000) return;
+  for (uint8_t i = 0; i < tankCount; i++) {
+    TankController& t = tanks[i];
+    watchdogBeat(WDT_TASK_HEATERS);
+    t.controlHeaters();
+    watchdogBeat(WDT_TASK_FEED);
+    t.handleFeedMode();
+    watchdogBeat(WDT_TASK_ATO);
+    t.handleATO();
+    watchdogBeat(WDT_TASK_LIGHTING);
+    t.handleLightingSchedule();
+    watchdogBeat(WDT_TASK_CLOUDS);
+    t.handleClouds();
+    watchdogBeat(WDT_TASK_LIGHTING);
+    t.resyncLights();
+  }
+  watchdogBeat(WDT_TASK_ENERGY);
+  energyService();
+  watchdogBeat(WDT_TASK_LEDS);
+  updateLEDs();
+  watchdogBeat(WDT_TASK_STATUS);
+  printStatus();
+  watchdogSaveSnapshot();
+}
+
+// One pass of control logic. Reads inputs only through the trace
+// seam, so tools/host/replay.cpp can drive it from a recorded trace.
+void controllerPass(uint8_t wakes) {
+  unsigned long now = ctlMillis();
+  bool tickDue = (now - lastTickTime >= TICK_INTERVAL);
+
+  // Buttons: on INT/E-stop edges, while held or settling, and once per tick
+  if (tickDue || (wakes & (WAKE_ESTOP | WAKE_BUTTON)) || buttonsBusy() || !CFG_BUTTON_BOX_INT_WIRED) {
+    watchdogBeat(WDT_TASK_BUTTONS);
+    handleButtons();
   }
+
+  // Float change: react now instead of at the next tick
+  if ((wakes & WAKE_FLOAT) && !tickDue && now - bootTime >= 30000) {
+    watchdogBeat(WDT_TASK_ATO);
+    for (uint8_t i = 0; i < tankCount; i++) tanks[i].handleATO();
+  }
+
+  if (tickDue) {
+    lastTickTime = now;
+    runTick();
+  }
+
+  // Queued IR: echoes, retries, next frame
+  irLinkService();
+
+  // Serial commands (never waits for a full line)
+  consoleService();
+}
+
+void loop() {
+  uint8_t wakes = idleTakeWakes();
+  ctlBeginPass(wakes);
+  controllerPass(wakes);
+
+  watchdogService();
+
+  // Replay seed for when the trace wraps, taken between actions
+  if (traceKeyframeDue() && !buttonsBusy() && !irLinkBusy() && consoleIdle()) traceKeyframe();
+  traceDumpService();
+
+  // Sleep until the next scheduled work (or an interrupt)
+  idleRequestDeadline(lastTickTime + TICK_INTERVAL);
+  if (buttonsBusy()) idleRequestDeadline(millis() + BUTTON_POLL_INTERVAL);
+  if (!CFG_BUTTON_BOX_INT_WIRED) idleRequestDeadline(millis() + BUTTON_FALLBACK_POLL);
+  if (irLinkBusy()) idleRequestDeadline(irLinkDeadline());
+  if (consoleBusy()) idleRequestDeadline(millis() + CONSOLE_POLL_MS);
+  if (traceDumpActive()) idleRequestDeadline(millis() + TRACE_DUMP_POLL_MS);
+  idleUntilNextDeadline();
 }
@@ -1,108 +1,133 @@
-#ifndef ATO_H
-#define ATO_H
-
-#include "config.h"
-#include "pin_definitions.h"
-
-#ifndef CFG_ATO_FLOAT_ACTIVE_LOW
-#define CFG_ATO_FLOAT_ACTIVE_LOW true
-#endif
-
-// External references
-extern unsigned long atoStartTime;
-extern unsigned long atoLastRunTime;
-extern bool atoRunning;
-extern bool atoTimeoutAlarm;
-extern bool atoReservoirAlarm;
-
-// Function declarations
-void handleATO();
-void resetATOAlarm();
-
-// ═══════════════════════════════════════════════════════════════
-// ATO FUNCTIONS
-// ═══════════════════════════════════════════════════════════════
-
-void handleATO() {
-  bool lowTriggered  = (digitalRead(ATO_FLOAT_LOW)  == (CFG_ATO_FLOAT_ACTIVE_LOW ? LOW : HIGH));
-  bool highTriggered = (digitalRead(ATO_FLOAT_HIGH) == (CFG_ATO_FLOAT_ACTIVE_LOW ? LOW : HIGH));
-  bool resEmpty      = (digitalRead(ATO_RESERVOIR_EMPTY) == (CFG_ATO_FLOAT_ACTIVE_LOW ? LOW : HIGH));
-
-  if (resEmpty) {
-    if (!atoReservoirAlarm) {
-      Serial.println("🚨 ATO RESERVOIR EMPTY!");
-      Serial.println("   Please refill ATO reservoir");
-      soundAlarm(3);
-      atoReservoirAlarm = true;
-    }
-    if (atoRunning) {
-      setRelay(RELAY_ATO_PUMP, false);
-      atoRunning = false;
-      Serial.println("   ATO pump stopped (reservoir empty)");
-    }
-    return;
-  } else {
-    if (atoReservoirAlarm) {
-      Serial.println("✓ ATO reservoir refilled");
-      atoReservoirAlarm = false;
-      // Optional: allow immediate top-off after refill
-      atoLastRunTime = 0;
-    }
-  }
-
-  if (millis() - atoLastRunTime < ATO_COOLDOWN && !atoRunning) return;
-
-  if (atoTimeoutAlarm) {
-    if (atoRunning) {
-      setRelay(RELAY_ATO_PUMP, false);
-      atoRunning = false;
-    }
-    return;
-  }
-
-  if (lowTriggered) {
-    if (!atoRunning) {
-      setRelay(RELAY_ATO_PUMP, true);
-      atoRunning = true;
-      atoStartTime = millis();
-      Serial.println("💧 ATO pump ON");
-    } else {
-      unsigned long runtime = millis() - atoStartTime;
-      if (runtime > ATO_TIMEOUT) {
-        setRelay(RELAY_ATO_PUMP, false);
-        atoRunning = false;
-        atoTimeoutAlarm = true;
-        Serial.println("🚨 ATO TIMEOUT ALARM!");
-        Serial.print("   Pump ran for ");
-        Serial.print(runtime / 1000);
-        Serial.println(" seconds");
-        soundAlarm(5);
-      }
-    }
-  } else if (highTriggered) {
-    if (atoRunning) {
-      unsigned long runtime = millis() - atoStartTime;
-      if (runtime >= ATO_MIN_RUNTIME) {
-        setRelay(RELAY_ATO_PUMP, false);
-        atoRunning = false;
-        atoLastRunTime = millis();
-        Serial.print("💧 ATO pump OFF (ran ");
-        Serial.print(runtime / 1000);
-        Serial.println(" sec)");
-      }
-    }
-  }
-}
-
-void resetATOAlarm() {
-  if (atoTimeoutAlarm || atoReservoirAlarm) {
-    atoTimeoutAlarm = false;
-    atoReservoirAlarm = false;
-    atoStartTime = 0;
-    atoLastRunTime = millis();
-    Serial.println("✓ ATO alarms reset");
-    tone(BUZZER_PIN, 2000, 100);
-  }
-}
-
-#endif
\ No newline at end of file
+#ifndef ATO_H
+#define ATO_H
+
+#include "config.h"
+#include "pin_definitions.h"
+#include "trace.h"
+#include "faults.h"
+#include "ato_stats.h"
+#include "tank.h"
+
+#ifndef CFG_ATO_FLOAT_ACTIVE_LOW
+#define CFG_ATO_FLOAT_ACTIVE_LOW true
+#endif
+
+// Function declarations
+void resetATOAlarm();
+
+// ═══════════════════════════════════════════════════════════════
+// ATO FUNCTIONS
+// ═══════════════════════════════════════════════════════════════
+
+static bool atoFloatActive(TracePin pin) {
+  if (pin == TRACE_PIN_NONE) return false;
+  return ctlReadPin(pin) == (CFG_ATO_FLOAT_ACTIVE_LOW ? LOW : HIGH);
+}
+
+void TankController::handleATO() {
+  if (!hasATO()) return;
+  atoStatsService(atoStats, ctlMillis());
+
+  bool lowTriggered  = atoFloatActive(pinFloatLow);
+  bool highTriggered = atoFloatActive(pinFloatHigh);
+  bool resEmpty      = atoFloatActive(pinReservoir);    // no reservoir float: never empty
+  uint8_t pump = cfg->relays.atoPump;
+
+  setCondition(FAULT_ATO_RESERVOIR, resEmpty);
+
+  if (resEmpty) {
+    if (!atoReservoirAlarm) {
+      Serial.printf("   %s: please refill ATO reservoir\n", cfg->name);
+      atoReservoirAlarm = true;
+    }
+    if (atoRunning) {
+      setOutput(pump, false);
+      atoRunning = false;
+      atoStatsRunFinished(atoStats, ctlMillis() - atoStartTime, false);
+      Serial.println("   ATO pump stopped (reservoir empty)");
+    }
+    setCondition(FAULT_ATO_ANOMALY, atoStats.anomalies != 0);
+    return;
+  } else {
+    if (atoReservoirAlarm) {
+      Serial.printf("✓ %s: ATO reservoir refilled\n", cfg->name);
+      atoReservoirAlarm = false;
+      atoStatsReservoirRefilled(atoStats);
+      // Optional: allow immediate top-off after refill
+      atoLastRunTime = 0;
+    }
+  }
+
+  if (ctlMillis() - atoLastRunTime < ATO_COOLDOWN && !atoRunning) return;
+
+  if (atoTimeoutAlarm) {
+    if (atoRunning) {
+      setOutput(pump, false);
+      atoRunning = false;
+    }
+    return;
+  }
+
+  if (lowTriggered) {
+    if (!atoRunning) {
+      setOutput(pump, true);
+      atoRunning = true;
+      atoStartTime = ctlMillis();
+      atoStatsRunStarted(atoStats, atoStartTime);
+      Serial.printf("💧 %s: ATO pump ON\n", cfg->name);
+    } else {
+      unsigned long runtime = ctlMillis() - atoStartTime;
+      if (runtime > ATO_TIMEOUT) {
+        setOutput(pump, false);
+        atoRunning = false;
+        atoTimeoutAlarm = true;
+        setCondition(FAULT_ATO_TIMEOUT, true);
+        atoStatsRunFinished(atoStats, runtime, true);
+        Serial.print("   ATO pump ran for ");
+        Serial.print(runtime / 1000);
+        Serial.println(" seconds");
+      }
+    }
+  } else if (highTriggered) {
+    if (atoRunning) {
+      unsigned long runtime = ctlMillis() - atoStartTime;
+      if (runtime >= ATO_MIN_RUNTIME) {
+        setOutput(pump, false);
+        atoRunning = false;
+        atoLastRunTime = ctlMillis();
+        atoStatsRunFinished(atoStats, runtime, false);
+        Serial.printf("💧 %s: ATO pump OFF (ran ", cfg->name);
+        Serial.print(runtime / 1000);
+        Serial.println(" sec)");
+      }
+    }
+  }
+  setCondition(FAULT_ATO_ANOMALY, atoStats.anomalies != 0);
+}
+
+void TankController::resetATOAlarm() {
+  atoTimeoutAlarm = false;
+  atoReservoirAlarm = false;
+  atoStartTime = 0;
+  atoLastRunTime = ctlMillis();
+  setCondition(FAULT_ATO_TIMEOUT, false);
+}
+
+// Reset button: clears every tank's ATO alarms
+void resetATOAlarm() {
+  bool any = false;
+  for (uint8_t i = 0; i < tankCount; i++) {
+    TankController& t = tanks[i];
+    if (t.atoTimeoutAlarm || t.atoReservoirAlarm) {
+      t.resetATOAlarm();
+      any = true;
+    }
+  }
+  if (any) {
+    faultReset(FAULT_BIT(FAULT_ATO_TIMEOUT) | FAULT_BIT(FAULT_ATO_RESERVOIR));
+    Serial.println("✓ ATO alarms reset");
+    tone(BUZZER_PIN, 2000, 100);
+  }
+}
+
+#endif
@@ -0,0 +1,272 @@
+#ifndef ATO_STATS_H
+#define ATO_STATS_H
+
+#include "config.h"
+#include "trace.h"
+#include "faults.h"
+
+// ═══════════════════════════════════════════════════════════════
+// ATO ANALYTICS
+// ═══════════════════════════════════════════════════════════════
+// Fixed-memory, O(1)-per-event statistics over ATO pump runs.
+// Runs and volume are kept in 24 hourly buckets (a rolling day);
+// averages use fast/slow EWMAs so drift shows up as a ratio. The ring
+// is advanced every tick (atoStatsService), not only when the pump
+// runs, so a dead pump or stuck float shows up as figures decaying.
+
+const uint8_t ATO_STATS_HOURS = 24;
+const unsigned long ATO_STATS_HOUR_MS = 3600000UL;
+const uint8_t ATO_STATS_RECENT_RUNS = 16;     // run end times kept for the sliding hour
+
+// EWMA weights: fast tracks the last few runs, slow the long-term norm
+const float ATO_EWMA_FAST = 0.25;
+const float ATO_EWMA_SLOW = 1.0 / 32.0;
+
+// Anomaly flags
+const uint8_t ATO_ANOMALY_LONG_RUNS     = 0x01;  // runs getting longer (siphon, weak pump)
+const uint8_t ATO_ANOMALY_FREQUENT_RUNS = 0x02;  // runs getting closer together (stuck float, leak)
+
+struct AtoStats {
+  // Rolling day
+  uint16_t hourRuns[ATO_STATS_HOURS];
+  float hourMl[ATO_STATS_HOURS];
+  uint8_t hourIdx;
+  unsigned long hourStart;
+  uint8_t hoursCovered;     // how many buckets hold real data (<= 24)
+  bool clockStarted;        // hourStart set by the first atoStatsService()
+  uint16_t dayRuns;         // running sum of hourRuns
+  float dayMl;              // running sum of hourMl
+
+  // Sliding hour: end times of the latest runs, newest at recentIdx
+  unsigned long recentRunEnd[ATO_STATS_RECENT_RUNS];
+  uint8_t recentIdx;
+
+  // Lifetime
+  uint32_t totalRuns;
+  float totalRuntimeSec;
+  float maxRuntimeSec;
+  uint16_t timeouts;
+
+  // Drift detection
+  float runtimeFast, runtimeSlow;
+  float intervalFast, intervalSlow;
+  unsigned long lastRunStart;
+  bool haveLastRun;
+  uint8_t anomalies;
+
+  // Reservoir
+  float mlSinceRefill;
+};
+
+// One AtoStats per tank (TankController::atoStats)
+
+// Function declarations
+void atoStatsService(AtoStats& atoStats, unsigned long now);
+void atoStatsRunStarted(AtoStats& atoStats, unsigned long now);
+void atoStatsRunFinished(AtoStats& atoStats, unsigned long runtimeMs, bool timedOut);
+void atoStatsReservoirRefilled(AtoStats& atoStats);
+uint16_t atoStatsRunsLastHour(const AtoStats& atoStats);
+float atoStatsMeanRuntimeSec(const AtoStats& atoStats);
+float atoStatsEvaporationMlPerDay(const AtoStats& atoStats);
+float atoStatsReservoirHoursLeft(const AtoStats& atoStats);
+void printAtoStats(const AtoStats& atoStats);
+void atoStatsKeyframe(TraceKeyframe& k, AtoStats& atoStats);
+
+// ═══════════════════════════════════════════════════════════════
+// INTERNALS
+// ═══════════════════════════════════════════════════════════════
+
+// Advance the hourly ring to the bucket containing `now`.
+// Bounded by ATO_STATS_HOURS steps, so still constant time.
+void atoStatsAdvance(AtoStats& atoStats, unsigned long now) {
+  unsigned long elapsedHours = (now - atoStats.hourStart) / ATO_STATS_HOUR_MS;
+  if (elapsedHours == 0) return;
+
+  uint8_t steps = (elapsedHours > ATO_STATS_HOURS) ? ATO_STATS_HOURS : (uint8_t)elapsedHours;
+  for (uint8_t i = 0; i < steps; i++) {
+    atoStats.hourIdx = (atoStats.hourIdx + 1) % ATO_STATS_HOURS;
+    atoStats.dayRuns -= atoStats.hourRuns[atoStats.hourIdx];
+    atoStats.dayMl   -= atoStats.hourMl[atoStats.hourIdx];
+    atoStats.hourRuns[atoStats.hourIdx] = 0;
+    atoStats.hourMl[atoStats.hourIdx] = 0;
+    if (atoStats.hoursCovered < ATO_STATS_HOURS) atoStats.hoursCovered++;
+  }
+  if (atoStats.dayMl < 0) atoStats.dayMl = 0;  // float drift guard
+
+  atoStats.hourStart += elapsedHours * ATO_STATS_HOUR_MS;
+}
+
+float atoEwma(float avg, float sample, float weight, bool first) {
+  return first ? sample : avg + weight * (sample - avg);
+}
+
+void atoStatsUpdateAnomalies(AtoStats& atoStats) {
+  uint8_t flags = 0;
+  if (atoStats.totalRuns >= ATO_ANOMALY_MIN_RUNS) {
+    if (atoStats.runtimeFast > atoStats.runtimeSlow * ATO_ANOMALY_RATIO) {
+      flags |= ATO_ANOMALY_LONG_RUNS;
+    }
+    if (atoStats.intervalFast > 0 &&
+        atoStats.intervalFast * ATO_ANOMALY_RATIO < atoStats.intervalSlow) {
+      flags |= ATO_ANOMALY_FREQUENT_RUNS;
+    }
+  }
+
+  uint8_t newFlags = flags & ~atoStats.anomalies;
+  atoStats.anomalies = flags;
+
+  if (newFlags & ATO_ANOMALY_LONG_RUNS) {
+    Serial.println("⚠️  ATO: runs getting longer (siphon or weak pump?)");
+  }
+  if (newFlags & ATO_ANOMALY_FREQUENT_RUNS) {
+    Serial.println("⚠️  ATO: runs getting more frequent (stuck float or leak?)");
+  }
+}
+
+// ═══════════════════════════════════════════════════════════════
+// EVENT HOOKS (called from TankController::handleATO)
+// ═══════════════════════════════════════════════════════════════
+
+// Every tick, pump running or not: empty hours roll into the day
+void atoStatsService(AtoStats& atoStats, unsigned long now) {
+  if (!atoStats.clockStarted) {
+    atoStats.hourStart = now;
+    atoStats.clockStarted = true;
+    return;
+  }
+  atoStatsAdvance(atoStats, now);
+}
+
+void atoStatsRunStarted(AtoStats& atoStats, unsigned long now) {
+  atoStatsService(atoStats, now);
+
+  if (atoStats.haveLastRun) {
+    float intervalSec = (now - atoStats.lastRunStart) / 1000.0;
+    bool first = (atoStats.intervalSlow == 0);
+    atoStats.intervalFast = atoEwma(atoStats.intervalFast, intervalSec, ATO_EWMA_FAST, first);
+    atoStats.intervalSlow = atoEwma(atoStats.intervalSlow, intervalSec, ATO_EWMA_SLOW, first);
+  }
+  atoStats.lastRunStart = now;
+  atoStats.haveLastRun = true;
+}
+
+void atoStatsRunFinished(AtoStats& atoStats, unsigned long runtimeMs, bool timedOut) {
+  unsigned long end = atoStats.lastRunStart + runtimeMs;
+  atoStatsAdvance(atoStats, end);
+  atoStats.recentIdx = (atoStats.recentIdx + 1) % ATO_STATS_RECENT_RUNS;
+  atoStats.recentRunEnd[atoStats.recentIdx] = end;
+
+  float runtimeSec = runtimeMs / 1000.0;
+  float ml = runtimeSec * ATO_PUMP_FLOW_ML_PER_SEC;
+  bool first = (atoStats.totalRuns == 0);
+
+  atoStats.hourRuns[atoStats.hourIdx]++;
+  atoStats.hourMl[atoStats.hourIdx] += ml;
+  atoStats.dayRuns++;
+  atoStats.dayMl += ml;
+
+  atoStats.totalRuns++;
+  atoStats.totalRuntimeSec += runtimeSec;
+  if (runtimeSec > atoStats.maxRuntimeSec) atoStats.maxRuntimeSec = runtimeSec;
+  if (timedOut) atoStats.timeouts++;
+
+  atoStats.runtimeFast = atoEwma(atoStats.runtimeFast, runtimeSec, ATO_EWMA_FAST, first);
+  atoStats.runtimeSlow = atoEwma(atoStats.runtimeSlow, runtimeSec, ATO_EWMA_SLOW, first);
+
+  atoStats.mlSinceRefill += ml;
+
+  atoStatsUpdateAnomalies(atoStats);
+}
+
+void atoStatsReservoirRefilled(AtoStats& atoStats) {
+  atoStats.mlSinceRefill = 0;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// DERIVED FIGURES
+// ═══════════════════════════════════════════════════════════════
+
+// Runs that ended in the last 60 minutes (not the current clock hour);
+// saturates at ATO_STATS_RECENT_RUNS, far past the anomaly threshold
+uint16_t atoStatsRunsLastHour(const AtoStats& atoStats) {
+  uint8_t kept = atoStats.totalRuns < ATO_STATS_RECENT_RUNS ? atoStats.totalRuns : ATO_STATS_RECENT_RUNS;
+  uint16_t runs = 0;
+  for (uint8_t i = 0; i < kept; i++) {
+    uint8_t idx = (atoStats.recentIdx + ATO_STATS_RECENT_RUNS - i) % ATO_STATS_RECENT_RUNS;
+    if (ctlMillis() - atoStats.recentRunEnd[idx] >= ATO_STATS_HOUR_MS) break;
+    runs++;
+  }
+  return runs;
+}
+
+float atoStatsMeanRuntimeSec(const AtoStats& atoStats) {
+  if (atoStats.totalRuns == 0) return 0;
+  return atoStats.totalRuntimeSec / atoStats.totalRuns;
+}
+
+// Daily evaporation, scaled up while we have less than a day of history
+float atoStatsEvaporationMlPerDay(const AtoStats& atoStats) {
+  if (!atoStats.clockStarted) return 0;
+  float hours = atoStats.hoursCovered + (ctlMillis() - atoStats.hourStart) / (float)ATO_STATS_HOUR_MS;
+  if (atoStats.totalRuns == 0 || hours < 1.0) return 0;
+  if (hours > ATO_STATS_HOURS) hours = ATO_STATS_HOURS;
+  return atoStats.dayMl * (ATO_STATS_HOURS / hours);
+}
+
+// Hours until the reservoir runs dry at the current evaporation rate (-1 = unknown)
+float atoStatsReservoirHoursLeft(const AtoStats& atoStats) {
+  float perDay = atoStatsEvaporationMlPerDay(atoStats);
+  if (perDay <= 0) return -1;
+  float remaining = ATO_RESERVOIR_CAPACITY_ML - atoStats.mlSinceRefill;
+  if (remaining < 0) remaining = 0;
+  return remaining / perDay * 24.0;
+}
+
+void printAtoStats(const AtoStats& atoStats) {
+  Serial.print("║ ATO Runs:      ");
+  Serial.print(atoStatsRunsLastHour(atoStats));
+  Serial.print("/h  ");
+  Serial.print(atoStats.dayRuns);
+  Serial.println("/day");
+
+  Serial.print("║ ATO Runtime:   avg ");
+  Serial.print(atoStatsMeanRuntimeSec(atoStats), 1);
+  Serial.print("s  max ");
+  Serial.print(atoStats.maxRuntimeSec, 1);
+  Serial.println("s");
+
+  Serial.print("║ Evaporation:   ");
+  Serial.print(atoStatsEvaporationMlPerDay(atoStats) / 1000.0, 2);
+  Serial.println(" L/day");
+
+  float hoursLeft = atoStatsReservoirHoursLeft(atoStats);
+  Serial.print("║ Reservoir:     ");
+  if (hoursLeft < 0) {
+    Serial.println("-- (learning)");
+  } else {
+    Serial.print(hoursLeft / 24.0, 1);
+    Serial.println(" days left");
+  }
+
+  if (atoStats.anomalies & ATO_ANOMALY_LONG_RUNS) {
+    Serial.println("║ ⚠️  ATO runs getting longer            ║");
+  }
+  if (atoStats.anomalies & ATO_ANOMALY_FREQUENT_RUNS) {
+    Serial.println("║ ⚠️  ATO runs getting more frequent     ║");
+  }
+}
+
+// Trace keyframe: the drift state behind FAULT_ATO_ANOMALY. The hourly
+// ring and lifetime totals only feed the status page and stay out.
+void atoStatsKeyframe(TraceKeyframe& k, AtoStats& atoStats) {
+  k.field(atoStats.totalRuns);
+  k.field(atoStats.runtimeFast);
+  k.field(atoStats.runtimeSlow);
+  k.field(atoStats.intervalFast);
+  k.field(atoStats.intervalSlow);
+  k.ms(atoStats.lastRunStart);
+  k.field(atoStats.haveLastRun);
+  k.field(atoStats.anomalies);
+}
+
+#endif
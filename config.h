@@ -1,73 +1,231 @@
-#ifndef CONFIG_H
-#define CONFIG_H
-
-// ═══════════════════════════════════════════════════════════════
-// TEMPERATURE SETTINGS
-// ═══════════════════════════════════════════════════════════════
-const float TARGET_TEMP = 78.0;
-const float TEMP_HYSTERESIS = 0.5;
-const float TEMP_DIFFERENTIAL_ALERT = 1.0;
-const float TEMP_EMERGENCY_HIGH = 82.0;
-
-// ═══════════════════════════════════════════════════════════════
-// ATO SETTINGS
-// ═══════════════════════════════════════════════════════════════
-const unsigned long ATO_TIMEOUT = 300000;        // 5 min
-const unsigned long ATO_COOLDOWN = 60000;        // 1 min
-const unsigned long ATO_MIN_RUNTIME = 2000;      // 2 sec
-// Float switch polarity (with INPUT_PULLUP, most float switches are ACTIVE-LOW when closed)
-#define CFG_ATO_FLOAT_ACTIVE_LOW true
-
-// ═══════════════════════════════════════════════════════════════
-// LIGHTING SCHEDULE
-// ═══════════════════════════════════════════════════════════════
-const uint8_t SUNRISE_START_HOUR = 9;
-const uint8_t SUNRISE_START_MINUTE = 30;
-const uint8_t SUNRISE_END_HOUR = 10;
-const uint8_t SUNRISE_END_MINUTE = 0;
-
-const uint8_t SUNSET_START_HOUR = 21;
-const uint8_t SUNSET_START_MINUTE = 30;
-const uint8_t SUNSET_END_HOUR = 22;
-const uint8_t SUNSET_END_MINUTE = 0;
-
-const int RAMP_STEPS = 20;
-const unsigned long RAMP_DURATION = 1800000;  // 30 min
-const unsigned long STEP_INTERVAL = RAMP_DURATION / RAMP_STEPS;
-
-// ═══════════════════════════════════════════════════════════════
-// CLOUD SIMULATION
-// ═══════════════════════════════════════════════════════════════
-const unsigned long CLOUD_MIN_INTERVAL = 600000;   // 10 min
-const unsigned long CLOUD_MAX_INTERVAL = 1800000;  // 30 min
-const int CLOUD_MIN_DIM_STEPS = 3;
-const int CLOUD_MAX_DIM_STEPS = 6;
-const unsigned long CLOUD_MIN_DURATION = 20000;    // 20 sec
-const unsigned long CLOUD_MAX_DURATION = 60000;    // 60 sec
-const unsigned long CLOUD_FADE_TIME = 15000;       // 15 sec
-
-// ═══════════════════════════════════════════════════════════════
-// FEED MODE
-// ═══════════════════════════════════════════════════════════════
-const unsigned long FEED_MODE_DURATION = 600000;  // 10 min
-// Gyre outlet wiring: true = use NC (recommended for "always on" devices)
-#define CFG_GYRE_WIRED_NC true
-
-// ═══════════════════════════════════════════════════════════════
-// IR LIGHT COMMANDS
-// ═══════════════════════════════════════════════════════════════
-const uint16_t IR_ADDRESS = 0xEF00;
-
-const uint8_t CMD_POWER = 0x0;
-const uint8_t CMD_FULL_BRIGHT = 0x2;
-const uint8_t CMD_NIGHT = 0x3;
-const uint8_t CMD_CH1_UP = 0x8;
-const uint8_t CMD_CH1_DOWN = 0x10;
-const uint8_t CMD_CH2_UP = 0x9;
-const uint8_t CMD_CH2_DOWN = 0x11;
-const uint8_t CMD_CH3_UP = 0xA;
-const uint8_t CMD_CH3_DOWN = 0x12;
-const uint8_t CMD_CH4_UP = 0xB;
-const uint8_t CMD_CH4_DOWN = 0x13;
-
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "pin_definitions.h"
+
+// ═══════════════════════════════════════════════════════════════
+// TEMPERATURE SETTINGS
+// ═══════════════════════════════════════════════════════════════
+const float TARGET_TEMP = 78.0;
+const float TEMP_HYSTERESIS = 0.5;
+const float TEMP_DIFFERENTIAL_ALERT = 1.0;
+const float TEMP_EMERGENCY_HIGH = 82.0;
+
+// ═══════════════════════════════════════════════════════════════
+// ATO SETTINGS
+// ═══════════════════════════════════════════════════════════════
+const unsigned long ATO_TIMEOUT = 300000;        // 5 min
+const unsigned long ATO_COOLDOWN = 60000;        // 1 min
+const unsigned long ATO_MIN_RUNTIME = 2000;      // 2 sec
+// Float switch polarity (with INPUT_PULLUP, most float switches are ACTIVE-LOW when closed)
+#define CFG_ATO_FLOAT_ACTIVE_LOW true
+
+// ATO analytics (measure your pump: ml delivered in 60 s / 60)
+const float ATO_PUMP_FLOW_ML_PER_SEC = 8.0;
+const float ATO_RESERVOIR_CAPACITY_ML = 18900.0;   // 5 gal
+const float ATO_ANOMALY_RATIO = 1.5;               // recent vs long-term average
+const uint16_t ATO_ANOMALY_MIN_RUNS = 8;           // runs before anomaly checks arm
+
+// ═══════════════════════════════════════════════════════════════
+// LIGHTING SCHEDULE
+// ═══════════════════════════════════════════════════════════════
+const uint8_t SUNRISE_START_HOUR = 9;
+const uint8_t SUNRISE_START_MINUTE = 30;
+const uint8_t SUNRISE_END_HOUR = 10;
+const uint8_t SUNRISE_END_MINUTE = 0;
+
+const uint8_t SUNSET_START_HOUR = 21;
+const uint8_t SUNSET_START_MINUTE = 30;
+const uint8_t SUNSET_END_HOUR = 22;
+const uint8_t SUNSET_END_MINUTE = 0;
+
+const int RAMP_STEPS = 20;
+const unsigned long RAMP_DURATION = 1800000;  // 30 min
+const unsigned long STEP_INTERVAL = RAMP_DURATION / RAMP_STEPS;
+
+// ═══════════════════════════════════════════════════════════════
+// CLOUD SIMULATION
+// ═══════════════════════════════════════════════════════════════
+const unsigned long CLOUD_MIN_INTERVAL = 600000;   // 10 min
+const unsigned long CLOUD_MAX_INTERVAL = 1800000;  // 30 min
+const int CLOUD_MIN_DIM_STEPS = 3;
+const int CLOUD_MAX_DIM_STEPS = 6;
+const unsigned long CLOUD_MIN_DURATION = 20000;    // 20 sec
+const unsigned long CLOUD_MAX_DURATION = 60000;    // 60 sec
+const unsigned long CLOUD_FADE_TIME = 15000;       // 15 sec
+
+// ═══════════════════════════════════════════════════════════════
+// FEED MODE
+// ═══════════════════════════════════════════════════════════════
+const unsigned long FEED_MODE_DURATION = 600000;  // 10 min
+// Gyre outlet wiring: true = use NC (recommended for "always on" devices)
+#define CFG_GYRE_WIRED_NC true
+
+// ═══════════════════════════════════════════════════════════════
+// IDLE / POWER
+// ═══════════════════════════════════════════════════════════════
+// Button box INT line wired to BUTTON_BOX_INT_PIN? If not, buttons are
+// polled every BUTTON_FALLBACK_POLL. Stock boards do not have the wire:
+// enabling this needs a jumper from the button-box PCF8574 INT pin
+// (open-drain) to BUTTON_BOX_INT_PIN; the internal pull-up is enough.
+// With it set but no wire, buttons are only read once per tick and
+// short presses are lost.
+#define CFG_BUTTON_BOX_INT_WIRED false
+// Use ESP32 light sleep while idle (stops tone() and drops WiFi); false = FreeRTOS block
+#define CFG_IDLE_LIGHT_SLEEP false
+const unsigned long TICK_INTERVAL = 500;           // scheduled work period
+const unsigned long BUTTON_POLL_INTERVAL = 10;     // while a button is held/settling
+const unsigned long BUTTON_FALLBACK_POLL = 50;     // when INT line is not wired
+const unsigned long LIGHT_SLEEP_MIN_MS = 20;       // shorter idles just block
+
+// ═══════════════════════════════════════════════════════════════
+// ENERGY METERING
+// ═══════════════════════════════════════════════════════════════
+// Load watts per relay channel (index = RELAY_* pin); measure with a plug-in meter
+const uint16_t RELAY_WATTS[8] = {
+  200,   // heater primary
+  200,   // heater backup
+  0,     // display light (IR-controlled fixture; add its watts if relay-switched)
+  20,    // sump light
+  40,    // return pump
+  15,    // gyre
+  5,     // ATO pump
+  0      // spare
+};
+const unsigned long ENERGY_SAVE_INTERVAL = 21600000;  // 6 h between NVS writes
+const float HEATER_DUTY_ALERT = 0.90;                 // 24 h duty that means undersized/failing
+const uint8_t ENERGY_DUTY_MIN_HOURS = 6;              // history needed before the duty alert arms
+
+// ═══════════════════════════════════════════════════════════════
+// INPUT TRACE
+// ═══════════════════════════════════════════════════════════════
+// Idle passes that repeat the previous interval share one REPEAT
+// record, so polling the button box (20 passes/s) costs a few bytes
+// per tick instead of 2 per pass. The host model (ATO cycle every
+// 4 min, probe noise, clouds) keeps ~4.5 h; loop timing jitter on the
+// board breaks up some runs, so expect less there.
+const uint32_t TRACE_BUFFER_SIZE = 32768;  // bytes
+
+// ═══════════════════════════════════════════════════════════════
+// IR LIGHT COMMANDS
+// ═══════════════════════════════════════════════════════════════
+const uint16_t IR_ADDRESS = 0xEF00;
+
+const uint8_t CMD_POWER = 0x0;
+const uint8_t CMD_FULL_BRIGHT = 0x2;
+const uint8_t CMD_NIGHT = 0x3;
+const uint8_t CMD_CH1_UP = 0x8;
+const uint8_t CMD_CH1_DOWN = 0x10;
+const uint8_t CMD_CH2_UP = 0x9;
+const uint8_t CMD_CH2_DOWN = 0x11;
+const uint8_t CMD_CH3_UP = 0xA;
+const uint8_t CMD_CH3_DOWN = 0x12;
+const uint8_t CMD_CH4_UP = 0xB;
+const uint8_t CMD_CH4_DOWN = 0x13;
+
+// Delivery: IR_RECV_PIN receiver can see our IR LED (loopback verify)
+#define CFG_IR_VERIFY true
+const unsigned long IR_FRAME_GAP_MS = 250;       // open-loop spacing (no echoes seen)
+const unsigned long IR_ACK_GAP_MS = 40;          // after an echoed frame
+const unsigned long IR_ECHO_TIMEOUT_MS = 200;    // per frame, +110 ms per repeat
+const unsigned long IR_ECHO_POLL_MS = 10;
+const unsigned long IR_RETRY_BACKOFF_MS = 100;
+const unsigned long IR_POWER_SETTLE_MS = 1000;   // fixture boot after power toggle
+const uint8_t IR_MAX_ATTEMPTS = 3;
+const uint8_t IR_LINK_FAIL_LIMIT = 3;            // undelivered frames in a row -> open loop
+
+// ═══════════════════════════════════════════════════════════════
+// TANKS
+// ═══════════════════════════════════════════════════════════════
+// One TankController per entry. Each tank has its own probes, relay
+// channels, floats, fixture and schedule; the I2C bus, relay box, IR
+// transmitter, buttons and E-stop are shared. The button box drives
+// the first tank. RELAY_NONE / PIN_NONE / TEMP_BUS_NONE = not fitted.
+const uint8_t TANK_MAX = 3;
+
+constexpr uint16_t clockMinutes(uint8_t hour, uint8_t minute) { return hour * 60 + minute; }
+
+struct TankProbe {
+  uint8_t bus;              // TEMP_BUS_*
+  uint8_t addr[8];          // DS18B20 ROM; all zero = next probe on the bus no config names
+};
+
+struct TankRelays {
+  uint8_t heaterPrimary;
+  uint8_t heaterBackup;
+  uint8_t returnPump;
+  uint8_t gyre;
+  uint8_t atoPump;
+};
+
+struct TankFloats {
+  uint8_t low;              // ATO runs only with both low and high fitted
+  uint8_t high;
+  uint8_t reservoir;
+};
+
+struct TankSchedule {
+  uint16_t sunriseStart;    // minutes since midnight
+  uint16_t sunriseEnd;
+  uint16_t sunsetStart;
+  uint16_t sunsetEnd;
+};
+
+struct TankConfig {
+  const char* name;
+  float targetTemp;
+  float hysteresis;
+  TankProbe control;        // drives the heaters
+  TankProbe reference;      // differential check only
+  TankRelays relays;
+  TankFloats floats;
+  bool lights;              // IR fixture fitted
+  uint16_t irAddress;
+  bool clouds;
+  TankSchedule schedule;
+};
+
+const TankConfig TANK_CONFIGS[] = {
+  {
+    "Display", TARGET_TEMP, TEMP_HYSTERESIS,
+    { TEMP_BUS_SUMP,    {0} },
+    { TEMP_BUS_DISPLAY, {0} },
+    { RELAY_HEATER_PRIMARY, RELAY_HEATER_BACKUP, RELAY_RETURN_PUMP, RELAY_GYRE, RELAY_ATO_PUMP },
+    { ATO_FLOAT_LOW, ATO_FLOAT_HIGH, ATO_RESERVOIR_EMPTY },
+    true, IR_ADDRESS, true,
+    { clockMinutes(SUNRISE_START_HOUR, SUNRISE_START_MINUTE), clockMinutes(SUNRISE_END_HOUR, SUNRISE_END_MINUTE),
+      clockMinutes(SUNSET_START_HOUR, SUNSET_START_MINUTE),   clockMinutes(SUNSET_END_HOUR, SUNSET_END_MINUTE) }
+  },
+  // Example: QT tank with one probe on the sump bus and a heater on the spare relay
+  // {
+  //   "QT", 79.0, 0.5,
+  //   { TEMP_BUS_SUMP, { 0x28, 0xFF, 0x4B, 0x1A, 0x62, 0x16, 0x03, 0xBC } },
+  //   { TEMP_BUS_NONE, {0} },
+  //   { RELAY_SPARE, RELAY_NONE, RELAY_NONE, RELAY_NONE, RELAY_NONE },
+  //   { PIN_NONE, PIN_NONE, PIN_NONE },
+  //   false, 0, false,
+  //   { 0, 0, 0, 0 }
+  // },
+};
+const uint8_t TANK_CONFIG_COUNT = sizeof(TANK_CONFIGS) / sizeof(TANK_CONFIGS[0]);
+
+// ═══════════════════════════════════════════════════════════════
+// TEMPERATURE PROBES
+// ═══════════════════════════════════════════════════════════════
+// Every DS18B20 on every bus is found at boot and matched to a role by
+// ROM. Tank probes come from TANK_CONFIGS; the roles below belong to
+// no tank and are only shown and logged. The boot log prints each ROM
+// nothing claimed, ready to paste here.
+const uint8_t TEMP_PROBE_MAX = 12;        // tank + role probes (trace has 16 channels)
+
+struct TempRoleConfig {
+  const char* role;
+  TankProbe probe;
+};
+
+const TempRoleConfig TEMP_ROLES[] = {
+  { "ambient", { TEMP_BUS_NONE, {0} } },   // e.g. { TEMP_BUS_DISPLAY, { 0x28, ... } }
+};
+const uint8_t TEMP_ROLE_COUNT = sizeof(TEMP_ROLES) / sizeof(TEMP_ROLES[0]);
+
 #endif
\ No newline at end of file
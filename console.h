@@ -0,0 +1,414 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include "config.h"
+#include "trace.h"
+#include "faults.h"
+#include "tank.h"
+#include "ato_stats.h"
+#include "energy.h"
+#include "ir_link.h"
+#include "idle.h"
+#include "watchdog.h"
+
+// ═══════════════════════════════════════════════════════════════
+// SERIAL CONSOLE
+// ═══════════════════════════════════════════════════════════════
+// Line-oriented commands on the USB serial port. Bytes are taken at
+// most CONSOLE_BYTES_PER_PASS per loop pass into a fixed line buffer
+// and parsed in place (no heap, no String): a command runs when its
+// newline arrives, so a slow or half-typed line never stalls loop().
+//
+// Every command ends with a line "OK" or "ERR <reason>", and values
+// come back as key=value, so a script can send a line and read until
+// it sees one of the two:
+//
+//   > set target 77.5 QT
+//   target=77.5 tank=QT
+//   OK
+//
+// Tank arguments are a name or index; omitted means the first tank.
+// Input comes through the trace seam (ctlConsoleRead), so a replayed
+// trace repeats the commands too.
+
+const uint8_t CONSOLE_LINE_MAX = 64;
+const uint8_t CONSOLE_ARGS_MAX = 6;
+const uint8_t CONSOLE_BYTES_PER_PASS = 32;
+const unsigned long CONSOLE_POLL_MS = 20;   // while a burst is still queued
+
+struct ConsoleCommand {
+  const char* name;
+  const char* usage;
+  void (*run)(uint8_t argc, char** argv);
+};
+
+// Runtime-adjustable tank settings (get/set)
+enum ConsoleSettingId : uint8_t {
+  SET_TARGET,
+  SET_HYSTERESIS,
+  SET_FEED,
+  SET_SCHEDULE,
+  SET_COUNT
+};
+
+struct ConsoleSetting {
+  const char* name;
+  const char* unit;
+  float min;
+  float max;
+  bool whole;                    // integer setting: reject fractions
+};
+
+const ConsoleSetting CONSOLE_SETTINGS[SET_COUNT] = {
+  { "target",   "°F",   70.0, TEMP_EMERGENCY_HIGH, false },
+  { "hyst",     "°F",   0.1,  3.0,                 false },
+  { "feed",     "min",  1,    60,                  false },
+  { "schedule", "0/1",  0,    1,                   true },
+};
+
+char consoleLine[CONSOLE_LINE_MAX];
+uint8_t consoleLen = 0;
+bool consoleOverflow = false;    // line too long: discard up to the newline
+uint32_t consoleCommands = 0;
+
+// External references
+extern bool emergencyStop;
+extern bool manualEstopLatched;
+extern bool alarmSilenced;
+
+// Forward declarations (main)
+void triggerEmergencyStop();
+bool attemptOverrideEstop();
+void printStatus(bool force);
+
+// Function declarations
+void consoleService();
+bool consoleBusy();
+bool consoleIdle();
+
+// ═══════════════════════════════════════════════════════════════
+// HELPERS
+// ═══════════════════════════════════════════════════════════════
+
+void consoleOk() {
+  Serial.println("OK");
+}
+
+void consoleError(const char* reason) {
+  Serial.print("ERR ");
+  Serial.println(reason);
+}
+
+// Name or index; nullptr if no such tank
+TankController* consoleTank(const char* arg) {
+  if (!arg) return tankCount ? &panelTank() : nullptr;
+  for (uint8_t i = 0; i < tankCount; i++) {
+    if (strcmp(tanks[i].cfg->name, arg) == 0) return &tanks[i];
+  }
+  char* end;
+  long idx = strtol(arg, &end, 10);
+  if (*end == '\0' && end != arg && idx >= 0 && idx < tankCount) return &tanks[idx];
+  return nullptr;
+}
+
+// Tank from argv[at] (optional); reports the error itself
+TankController* consoleTankArg(uint8_t argc, char** argv, uint8_t at) {
+  TankController* t = consoleTank(at < argc ? argv[at] : nullptr);
+  if (!t) consoleError("no such tank");
+  return t;
+}
+
+int8_t consoleSettingId(const char* name) {
+  for (uint8_t i = 0; i < SET_COUNT; i++) {
+    if (strcmp(CONSOLE_SETTINGS[i].name, name) == 0) return i;
+  }
+  return -1;
+}
+
+float consoleGetSetting(const TankController& t, uint8_t id) {
+  switch (id) {
+    case SET_TARGET:     return t.targetTemp;
+    case SET_HYSTERESIS: return t.hysteresis;
+    case SET_FEED:       return t.feedDurationMs / 60000.0;
+    case SET_SCHEDULE:   return t.scheduledLightsEnabled ? 1 : 0;
+    default:             return 0;
+  }
+}
+
+void consoleApplySetting(TankController& t, uint8_t id, float value) {
+  switch (id) {
+    case SET_TARGET:     t.targetTemp = value; break;
+    case SET_HYSTERESIS: t.hysteresis = value; break;
+    case SET_FEED:       t.feedDurationMs = (unsigned long)(value * 60000); break;
+    case SET_SCHEDULE:   t.scheduledLightsEnabled = value != 0; break;
+  }
+}
+
+void consolePrintSetting(const TankController& t, uint8_t id) {
+  Serial.printf("%s=%.*f tank=%s\n", CONSOLE_SETTINGS[id].name,
+                id == SET_SCHEDULE ? 0 : 2, consoleGetSetting(t, id), t.cfg->name);
+}
+
+// One machine-readable line per tank
+void consolePrintTank(const TankController& t) {
+  Serial.printf("TANK %s temp=%.2f ref=%.2f target=%.2f hyst=%.2f heater=%d light=%u cloud=%u "
+                "feed=%d photo=%d ato=%d atoAlarm=%d faults=0x%04X stop=%d\n",
+                t.cfg->name, t.tempControl, t.hasReference() ? t.tempReference : 0.0,
+                t.targetTemp, t.hysteresis, t.heaterPrimaryOn, (unsigned)t.currentLightMode,
+                (unsigned)t.cloudState, t.feedModeActive, t.photoModeActive, t.atoRunning,
+                t.atoTimeoutAlarm || t.atoReservoirAlarm, (unsigned)t.faults.active, t.stopped());
+}
+
+// ═══════════════════════════════════════════════════════════════
+// COMMANDS
+// ═══════════════════════════════════════════════════════════════
+
+void cmdHelp(uint8_t argc, char** argv);
+
+// get <setting> [tank]
+void cmdGet(uint8_t argc, char** argv) {
+  if (argc < 2) return consoleError("usage");
+  int8_t id = consoleSettingId(argv[1]);
+  if (id < 0) return consoleError("unknown setting");
+  TankController* t = consoleTankArg(argc, argv, 2);
+  if (!t) return;
+  consolePrintSetting(*t, id);
+  consoleOk();
+}
+
+// set <setting> <value> [tank]
+void cmdSet(uint8_t argc, char** argv) {
+  if (argc < 3) return consoleError("usage");
+  int8_t id = consoleSettingId(argv[1]);
+  if (id < 0) return consoleError("unknown setting");
+  char* end;
+  float value = strtof(argv[2], &end);
+  if (*end != '\0' || end == argv[2]) return consoleError("bad value");
+  const ConsoleSetting& s = CONSOLE_SETTINGS[id];
+  if (value < s.min || value > s.max) return consoleError("out of range");
+  if (s.whole && value != (long)value) return consoleError("bad value");
+  TankController* t = consoleTankArg(argc, argv, 3);
+  if (!t) return;
+  // The heater cut-out (target + hyst) must stay below the emergency trip
+  float target = id == SET_TARGET ? value : t->targetTemp;
+  float hyst = id == SET_HYSTERESIS ? value : t->hysteresis;
+  if ((id == SET_TARGET || id == SET_HYSTERESIS) && target + hyst >= TEMP_EMERGENCY_HIGH) {
+    return consoleError("out of range");
+  }
+  consoleApplySetting(*t, id, value);
+  consolePrintSetting(*t, id);
+  consoleOk();
+}
+
+// mode <feed|photo|cloud|lights> [tank]: same as the buttons
+void cmdMode(uint8_t argc, char** argv) {
+  if (argc < 2) return consoleError("usage");
+  TankController* t = consoleTankArg(argc, argv, 2);
+  if (!t) return;
+  if (t->stopped()) return consoleError("e-stop active");
+
+  const char* mode = argv[1];
+  if (strcmp(mode, "feed") == 0) {
+    t->toggleFeedMode();
+    Serial.printf("feed=%d tank=%s\n", t->feedModeActive, t->cfg->name);
+  } else if (strcmp(mode, "photo") == 0) {
+    t->togglePhotoMode();
+    Serial.printf("photo=%d tank=%s\n", t->photoModeActive, t->cfg->name);
+  } else if (strcmp(mode, "cloud") == 0) {
+    if (t->currentLightMode != FULL_DAYLIGHT || t->cloudState != NO_CLOUD) return consoleError("not in daylight");
+    t->triggerManualCloud();
+  } else if (strcmp(mode, "lights") == 0) {
+    if (t->currentLightMode == NIGHT_MODE) t->lightsFullBright();
+    else t->setNightMode();
+  } else {
+    return consoleError("unknown mode");
+  }
+  consoleOk();
+}
+
+void cmdEstop(uint8_t, char**) {
+  triggerEmergencyStop();
+  consoleOk();
+}
+
+// Same gate as the blue-hold + red combo
+void cmdResume(uint8_t, char**) {
+  if (!tanksAnyStopped()) return consoleError("not stopped");
+  if (!attemptOverrideEstop()) return consoleError("blocked by fault");
+  consoleOk();
+}
+
+void cmdSilence(uint8_t, char**) {
+  silenceAlarm();
+  consoleOk();
+}
+
+// ack [mask]: ATO alarms, or the given latched faults (hex, one bit
+// per FaultId)
+void cmdAck(uint8_t argc, char** argv) {
+  if (argc < 2) {
+    resetATOAlarm();
+  } else {
+    char* end;
+    unsigned long mask = strtoul(argv[1], &end, 16);
+    if (*end != '\0' || end == argv[1] || argv[1][0] == '-') return consoleError("bad mask");
+    if (mask == 0 || mask >= (1UL << FAULT_COUNT)) return consoleError("out of range");
+    faultReset((FaultMask)mask);
+  }
+  Serial.printf("faults=0x%04X latched=0x%04X\n", (unsigned)faultActiveMask, (unsigned)faultLatchedMask);
+  consoleOk();
+}
+
+void cmdStatus(uint8_t, char**) {
+  printStatus(true);
+  consoleOk();
+}
+
+// Key=value state of every tank and the board
+void cmdTelemetry(uint8_t, char**) {
+  Serial.printf("BOARD ms=%lu estop=%d latched=%d silenced=%d faults=0x%04X latchedFaults=0x%04X idle=%.1f\n",
+                ctlMillis(), emergencyStop, manualEstopLatched, alarmSilenced,
+                (unsigned)faultActiveMask, (unsigned)faultLatchedMask, idlePercent());
+  for (uint8_t i = 0; i < tankCount; i++) consolePrintTank(tanks[i]);
+  printTempProbes(Serial);
+  printEnergyTelemetry(Serial);
+  printIrCommandStats(Serial);
+  consoleOk();
+}
+
+// hist <ato|wakes> [tank]
+void cmdHist(uint8_t argc, char** argv) {
+  if (argc < 2) return consoleError("usage");
+  if (strcmp(argv[1], "ato") == 0) {
+    TankController* t = consoleTankArg(argc, argv, 2);
+    if (!t) return;
+    // Oldest hour first; the last row is the current, partial hour
+    const AtoStats& s = t->atoStats;
+    for (uint8_t h = 0; h < ATO_STATS_HOURS; h++) {
+      uint8_t i = (s.hourIdx + 1 + h) % ATO_STATS_HOURS;
+      Serial.printf("ATOHIST tank=%s hoursAgo=%u runs=%u ml=%.0f\n", t->cfg->name,
+                    ATO_STATS_HOURS - 1 - h, s.hourRuns[i], s.hourMl[i]);
+    }
+  } else if (strcmp(argv[1], "wakes") == 0) {
+    for (uint8_t i = 0; i < WAKE_SOURCE_COUNT; i++) {
+      Serial.printf("WAKEHIST source=%s count=%lu\n", WAKE_SOURCE_NAMES[i], (unsigned long)idleWakeCounts[i]);
+    }
+  } else {
+    return consoleError("unknown histogram");
+  }
+  consoleOk();
+}
+
+// Writes the RTC snapshot now and echoes what a warm restart would restore
+void cmdSnapshot(uint8_t, char**) {
+  watchdogSaveSnapshot();
+  const ControllerSnapshot& s = rtcSnapshot;
+  Serial.printf("SNAPSHOT v=%u crc=%08lX estop=%d relays=0x%02X latched=0x%04X tanks=%u\n",
+                s.version, (unsigned long)s.crc, s.emergencyStop, s.relayStates,
+                (unsigned)s.faultLatched, s.tankCount);
+  for (uint8_t i = 0; i < s.tankCount; i++) {
+    const TankSnapshot& t = s.tanks[i];
+    Serial.printf("SNAPSHOT tank=%s light=%u step=%d feed=%d photo=%d target=%.2f hyst=%.2f feedMin=%lu\n",
+                  tanks[i].cfg->name, t.lightMode, t.rampStep, t.feedModeActive, t.photoModeActive,
+                  t.targetTemp, t.hysteresis, (unsigned long)(t.feedDurationMs / 60000));
+  }
+  consoleOk();
+}
+
+// Replaces the old single-key 'T' trigger. The dump streams from the
+// loop (traceDumpService) and ends with its own TRACE END line.
+void cmdTrace(uint8_t, char**) {
+  if (!traceDumpStart(Serial)) return consoleError("dump in progress");
+  consoleOk();
+}
+
+const ConsoleCommand CONSOLE_COMMANDS[] = {
+  { "help",      "",                              cmdHelp },
+  { "get",       "<setting> [tank]",              cmdGet },
+  { "set",       "<setting> <value> [tank]",      cmdSet },
+  { "mode",      "<feed|photo|cloud|lights> [tank]", cmdMode },
+  { "estop",     "",                              cmdEstop },
+  { "resume",    "",                              cmdResume },
+  { "silence",   "",                              cmdSilence },
+  { "ack",       "[fault mask hex]",              cmdAck },
+  { "status",    "",                              cmdStatus },
+  { "telemetry", "",                              cmdTelemetry },
+  { "hist",      "<ato|wakes> [tank]",            cmdHist },
+  { "snapshot",  "",                              cmdSnapshot },
+  { "trace",     "",                              cmdTrace },
+};
+const uint8_t CONSOLE_COMMAND_COUNT = sizeof(CONSOLE_COMMANDS) / sizeof(CONSOLE_COMMANDS[0]);
+
+void cmdHelp(uint8_t, char**) {
+  for (uint8_t i = 0; i < CONSOLE_COMMAND_COUNT; i++) {
+    const ConsoleCommand& c = CONSOLE_COMMANDS[i];
+    Serial.printf("%s%s%s\n", c.name, *c.usage ? " " : "", c.usage);
+  }
+  for (uint8_t i = 0; i < SET_COUNT; i++) {
+    const ConsoleSetting& s = CONSOLE_SETTINGS[i];
+    Serial.printf("setting %s (%s, %g..%g)\n", s.name, s.unit, s.min, s.max);
+  }
+  consoleOk();
+}
+
+// ═══════════════════════════════════════════════════════════════
+// PARSER
+// ═══════════════════════════════════════════════════════════════
+
+// Splits the line in place and runs the matching command
+void consoleExecute(char* line) {
+  char* argv[CONSOLE_ARGS_MAX];
+  uint8_t argc = 0;
+  char* p = line;
+  while (*p) {
+    while (*p == ' ' || *p == '\t') *p++ = '\0';
+    if (!*p) break;
+    if (argc == CONSOLE_ARGS_MAX) return consoleError("too many arguments");
+    argv[argc++] = p;
+    while (*p && *p != ' ' && *p != '\t') p++;
+  }
+  if (argc == 0) return;
+
+  for (uint8_t i = 0; i < CONSOLE_COMMAND_COUNT; i++) {
+    if (strcmp(CONSOLE_COMMANDS[i].name, argv[0]) == 0) {
+      consoleCommands++;
+      CONSOLE_COMMANDS[i].run(argc, argv);
+      return;
+    }
+  }
+  consoleError("unknown command (try help)");
+}
+
+// Once per loop pass, from controllerPass()
+void consoleService() {
+  uint8_t c;
+  for (uint8_t n = 0; n < CONSOLE_BYTES_PER_PASS && ctlConsoleRead(c); n++) {
+    if (c == '\r' || c == '\n') {
+      if (consoleOverflow) {
+        consoleError("line too long");
+      } else if (consoleLen) {
+        consoleLine[consoleLen] = '\0';
+        consoleExecute(consoleLine);
+      }
+      consoleLen = 0;
+      consoleOverflow = false;
+    } else if (consoleLen < CONSOLE_LINE_MAX - 1) {
+      consoleLine[consoleLen++] = c;
+    } else {
+      consoleOverflow = true;
+    }
+  }
+}
+
+// More input already waiting than one pass takes: come back soon.
+// Otherwise a typed line is picked up by the next tick at the latest.
+bool consoleBusy() {
+  return !traceReplayActive && Serial.available();
+}
+
+// Nothing waiting and no half-typed line (trace keyframes)
+bool consoleIdle() {
+  return consoleLen == 0 && !consoleOverflow && !consoleBusy();
+}
+
+#endif
@@ -0,0 +1,309 @@
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <Preferences.h>
+#include "config.h"
+#include "pin_definitions.h"
+#include "trace.h"
+#include "faults.h"
+
+// ═══════════════════════════════════════════════════════════════
+// ENERGY / DUTY-CYCLE METERING
+// ═══════════════════════════════════════════════════════════════
+// setRelay() reports every write of the relayStates shadow; only the
+// channels whose bit flipped are touched, so accounting is O(1) per
+// transition. On-time goes into 24 hourly buckets per channel (rolling
+// day) and lifetime totals; energy = on-time x RELAY_WATTS.
+//
+// Lifetime totals are saved to NVS as one blob every
+// ENERGY_SAVE_INTERVAL. A save is skipped only if no load ran and no
+// relay switched in the meantime. With the return pump running that
+// never happens, so the interval alone bounds flash wear (4 writes a
+// day). Rolling windows are RAM only and restart after a reboot.
+
+const uint8_t ENERGY_CHANNELS = 8;
+const uint8_t ENERGY_HOURS = 24;
+const unsigned long ENERGY_HOUR_MS = 3600000UL;
+const uint16_t ENERGY_PERSIST_VERSION = 1;
+
+const char* const RELAY_NAMES[ENERGY_CHANNELS] = {
+  "heater1", "heater2", "light", "sumplight", "return", "gyre", "ato", "spare"
+};
+
+// Channels whose load is powered while the relay is released (NC wiring)
+const uint8_t ENERGY_NC_MASK = CFG_GYRE_WIRED_NC ? (1 << RELAY_GYRE) : 0;
+uint8_t energyHeaterMask = 0;            // filled in by each tank's begin() (tank.h)
+
+// Persisted part (NVS blob)
+struct EnergyLifetime {
+  uint16_t version;
+  uint64_t onMs[ENERGY_CHANNELS];
+  uint64_t milliJoules[ENERGY_CHANNELS];   // on-ms x watts
+  uint32_t switches[ENERGY_CHANNELS];      // relay coil transitions (wear)
+};
+
+struct EnergyMeter {
+  bool started;
+  uint8_t relayShadow;      // last relayStates seen
+  uint8_t loadOn;           // bit set = load powered
+  unsigned long onSince[ENERGY_CHANNELS];
+
+  // Rolling day
+  uint32_t hourOnMs[ENERGY_HOURS][ENERGY_CHANNELS];
+  uint16_t hourSwitches[ENERGY_HOURS][ENERGY_CHANNELS];
+  uint32_t dayOnMs[ENERGY_CHANNELS];        // running sums of the buckets
+  uint16_t daySwitches[ENERGY_CHANNELS];
+  uint8_t hourIdx;
+  uint8_t hoursCovered;
+  unsigned long hourStart;
+  bool hourRolled;          // telemetry due
+
+  // Persistence
+  bool dirty;
+  unsigned long lastSave;
+};
+
+EnergyMeter energy = {};
+EnergyLifetime energyLife = {};
+Preferences energyPrefs;
+
+// External references
+extern uint8_t relayStates;
+
+// Function declarations
+void energyBegin();
+void energyOnRelayWrite(uint8_t states);
+void energyService();
+float energyDutyHour(uint8_t ch);
+float energyDutyDay(uint8_t ch);
+float energyKwhDay(uint8_t ch);
+float energyKwhLifetime(uint8_t ch);
+void printEnergyStats();
+void printEnergyTelemetry(Print& out);
+void reportHeaterDuty();
+
+// ═══════════════════════════════════════════════════════════════
+// INTERNALS
+// ═══════════════════════════════════════════════════════════════
+
+uint8_t energyLoadMask(uint8_t states) {
+  return (uint8_t)(~states ^ ENERGY_NC_MASK);   // relays are active-LOW
+}
+
+void energyCredit(uint8_t ch, unsigned long ms) {
+  if (ms == 0) return;
+  energy.hourOnMs[energy.hourIdx][ch] += ms;
+  energy.dayOnMs[ch] += ms;
+  energyLife.onMs[ch] += ms;
+  energyLife.milliJoules[ch] += (uint64_t)ms * RELAY_WATTS[ch];
+  energy.dirty = true;
+}
+
+// Credit running loads up to `until` and restart their interval there
+void energyFlushRunning(unsigned long until) {
+  uint8_t on = energy.loadOn;
+  for (uint8_t ch = 0; on; ch++, on >>= 1) {
+    if (!(on & 1)) continue;
+    energyCredit(ch, until - energy.onSince[ch]);
+    energy.onSince[ch] = until;
+  }
+}
+
+// Advance the hourly ring to the bucket containing `now`. Normally
+// zero or one step; running loads are split at each hour boundary.
+void energyAdvance(unsigned long now) {
+  while (now - energy.hourStart >= ENERGY_HOUR_MS) {
+    unsigned long boundary = energy.hourStart + ENERGY_HOUR_MS;
+    energyFlushRunning(boundary);
+
+    energy.hourIdx = (energy.hourIdx + 1) % ENERGY_HOURS;
+    for (uint8_t ch = 0; ch < ENERGY_CHANNELS; ch++) {
+      energy.dayOnMs[ch] -= energy.hourOnMs[energy.hourIdx][ch];
+      energy.daySwitches[ch] -= energy.hourSwitches[energy.hourIdx][ch];
+      energy.hourOnMs[energy.hourIdx][ch] = 0;
+      energy.hourSwitches[energy.hourIdx][ch] = 0;
+    }
+    if (energy.hoursCovered < ENERGY_HOURS) energy.hoursCovered++;
+    energy.hourStart = boundary;
+    energy.hourRolled = true;
+  }
+}
+
+unsigned long energyRunningMs(uint8_t ch, unsigned long now) {
+  return (energy.loadOn & (1 << ch)) ? now - energy.onSince[ch] : 0;
+}
+
+void energyLoad() {
+  EnergyLifetime saved;
+  size_t len = energyPrefs.getBytes("life", &saved, sizeof(saved));
+  if (len == sizeof(saved) && saved.version == ENERGY_PERSIST_VERSION) {
+    energyLife = saved;
+  } else {
+    memset(&energyLife, 0, sizeof(energyLife));
+    energyLife.version = ENERGY_PERSIST_VERSION;
+  }
+}
+
+void energySave() {
+  energyFlushRunning(ctlMillis());
+  energyPrefs.putBytes("life", &energyLife, sizeof(energyLife));
+  energy.dirty = false;
+  energy.lastSave = ctlMillis();
+}
+
+// ═══════════════════════════════════════════════════════════════
+// HOOKS
+// ═══════════════════════════════════════════════════════════════
+
+// Call once relays hold their boot/restored state
+void energyBegin() {
+  unsigned long now = ctlMillis();
+  energyPrefs.begin("energy", false);
+  energyLoad();
+
+  energy.relayShadow = relayStates;
+  energy.loadOn = energyLoadMask(relayStates);
+  for (uint8_t ch = 0; ch < ENERGY_CHANNELS; ch++) energy.onSince[ch] = now;
+  energy.hourStart = now;
+  energy.lastSave = now;
+  energy.started = true;
+  Serial.println("✓ Energy metering started");
+}
+
+// Called from setRelay() after relayStates changes
+void energyOnRelayWrite(uint8_t states) {
+  if (!energy.started) return;
+  uint8_t changed = states ^ energy.relayShadow;
+  if (!changed) return;
+
+  unsigned long now = ctlMillis();
+  energyAdvance(now);
+
+  uint8_t load = energyLoadMask(states);
+  for (uint8_t ch = 0; changed; ch++, changed >>= 1) {
+    if (!(changed & 1)) continue;
+    energy.hourSwitches[energy.hourIdx][ch]++;
+    energy.daySwitches[ch]++;
+    energyLife.switches[ch]++;
+    if (load & (1 << ch)) {
+      energy.onSince[ch] = now;
+    } else {
+      energyCredit(ch, now - energy.onSince[ch]);
+    }
+  }
+  energy.relayShadow = states;
+  energy.loadOn = load;
+  energy.dirty = true;
+}
+
+// Once per tick: roll windows, catch direct relay writes, watch heater duty, persist
+void energyService() {
+  if (!energy.started) return;
+  unsigned long now = ctlMillis();
+  energyOnRelayWrite(relayStates);
+  energyAdvance(now);
+
+  bool heaterHot = false;
+  if (energy.hoursCovered >= ENERGY_DUTY_MIN_HOURS) {
+    for (uint8_t ch = 0; ch < ENERGY_CHANNELS; ch++) {
+      if ((energyHeaterMask & (1 << ch)) && energyDutyDay(ch) >= HEATER_DUTY_ALERT) heaterHot = true;
+    }
+  }
+  faultSetCondition(FAULT_HEATER_DUTY, heaterHot);
+
+  if (energy.hourRolled) {
+    energy.hourRolled = false;
+    printEnergyTelemetry(Serial);
+  }
+
+  if (energy.dirty && now - energy.lastSave >= ENERGY_SAVE_INTERVAL) {
+    energySave();
+  }
+}
+
+// ═══════════════════════════════════════════════════════════════
+// DERIVED FIGURES
+// ═══════════════════════════════════════════════════════════════
+
+// Last 60 minutes: current bucket plus the overlapping part of the previous one
+float energyDutyHour(uint8_t ch) {
+  unsigned long now = ctlMillis();
+  unsigned long intoHour = now - energy.hourStart;
+  float onMs = energy.hourOnMs[energy.hourIdx][ch] + energyRunningMs(ch, now);
+  float windowMs = intoHour;
+  if (energy.hoursCovered > 0) {
+    uint8_t prev = (energy.hourIdx + ENERGY_HOURS - 1) % ENERGY_HOURS;
+    float overlap = 1.0 - intoHour / (float)ENERGY_HOUR_MS;
+    onMs += energy.hourOnMs[prev][ch] * overlap;
+    windowMs = ENERGY_HOUR_MS;
+  }
+  return windowMs > 0 ? onMs / windowMs : 0;
+}
+
+// Current bucket plus the full ones behind it: at most 23 h + the hour so far
+float energyDutyDay(uint8_t ch) {
+  unsigned long now = ctlMillis();
+  uint8_t fullHours = energy.hoursCovered < ENERGY_HOURS - 1 ? energy.hoursCovered : ENERGY_HOURS - 1;
+  float windowMs = fullHours * (float)ENERGY_HOUR_MS + (now - energy.hourStart);
+  if (windowMs <= 0) return 0;
+  return (energy.dayOnMs[ch] + energyRunningMs(ch, now)) / windowMs;
+}
+
+float energyKwhDay(uint8_t ch) {
+  float onMs = energy.dayOnMs[ch] + energyRunningMs(ch, ctlMillis());
+  return onMs * RELAY_WATTS[ch] / 3.6e9;
+}
+
+float energyKwhLifetime(uint8_t ch) {
+  double mj = energyLife.milliJoules[ch] + (double)energyRunningMs(ch, ctlMillis()) * RELAY_WATTS[ch];
+  return mj / 3.6e9;
+}
+
+void reportHeaterDuty() {
+  for (uint8_t ch = 0; ch < ENERGY_CHANNELS; ch++) {
+    if (!(energyHeaterMask & (1 << ch))) continue;
+    Serial.printf("   %s: %.0f%% duty over %u h\n", RELAY_NAMES[ch], energyDutyDay(ch) * 100, energy.hoursCovered);
+  }
+}
+
+void printEnergyStats() {
+  float dayKwh = 0, totalKwh = 0;
+  for (uint8_t ch = 0; ch < ENERGY_CHANNELS; ch++) {
+    dayKwh += energyKwhDay(ch);
+    totalKwh += energyKwhLifetime(ch);
+  }
+
+  Serial.print("║ Duty 1h/24h:   heat ");
+  Serial.print(energyDutyHour(RELAY_HEATER_PRIMARY) * 100, 0);
+  Serial.print("/");
+  Serial.print(energyDutyDay(RELAY_HEATER_PRIMARY) * 100, 0);
+  Serial.print("%  ret ");
+  Serial.print(energyDutyDay(RELAY_RETURN_PUMP) * 100, 0);
+  Serial.print("%  ato ");
+  Serial.print(energyDutyDay(RELAY_ATO_PUMP) * 100, 1);
+  Serial.println("%");
+
+  Serial.print("║ Energy:        ");
+  Serial.print(dayKwh, 2);
+  Serial.print(" kWh/24h  ");
+  Serial.print(totalKwh, 1);
+  Serial.println(" kWh total");
+}
+
+// One machine-readable line per channel:
+// ENERGY <name> on=<0|1> duty1h=<%> duty24h=<%> kwh24h=<> kwh=<> sw24h=<> sw=<>
+void printEnergyTelemetry(Print& out) {
+  for (uint8_t ch = 0; ch < ENERGY_CHANNELS; ch++) {
+    out.printf("ENERGY %s on=%d duty1h=%.1f duty24h=%.1f kwh24h=%.3f kwh=%.2f sw24h=%u sw=%lu\n",
+               RELAY_NAMES[ch],
+               (energy.loadOn >> ch) & 1,
+               energyDutyHour(ch) * 100,
+               energyDutyDay(ch) * 100,
+               energyKwhDay(ch),
+               energyKwhLifetime(ch),
+               energy.daySwitches[ch],
+               (unsigned long)energyLife.switches[ch]);
+  }
+}
+
+#endif
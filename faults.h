@@ -0,0 +1,284 @@
+#ifndef FAULTS_H
+#define FAULTS_H
+
+#include "config.h"
+#include "pin_definitions.h"
+#include "trace.h"
+
+// ═══════════════════════════════════════════════════════════════
+// FAULT REGISTRY
+// ═══════════════════════════════════════════════════════════════
+// Modules only report raw conditions (faultSetCondition). One pass of
+// evaluateFaults() per tick debounces, latches and alerts, and produces
+// faultActiveMask, which LEDs, buzzer and status all read.
+// Adding a fault = new FaultId + one row in FAULT_TABLE.
+//
+// Each tank keeps its own FaultState (registered with faultRegister),
+// so its faults debounce, latch and stop only that tank: an E-stop
+// fault calls triggerFaultStop() with the state it came from. Faults
+// that belong to no tank (IR link, heater duty, probe map) live in
+// faultBoard.
+// faultActiveMask / faultLatchedMask are the OR over all of them.
+
+enum FaultId : uint8_t {
+  FAULT_OVER_TEMP,
+  FAULT_TEMP_DIFFERENTIAL,
+  FAULT_SENSOR_SUMP,
+  FAULT_SENSOR_DISPLAY,
+  FAULT_ATO_TIMEOUT,
+  FAULT_ATO_RESERVOIR,
+  FAULT_ATO_ANOMALY,
+  FAULT_HEATER_DUTY,
+  FAULT_IR_LINK,
+  FAULT_PROBE_MAP,
+  FAULT_COUNT
+};
+
+enum FaultSeverity : uint8_t {
+  FAULT_SEV_INFO,
+  FAULT_SEV_WARNING,
+  FAULT_SEV_CRITICAL
+};
+
+typedef uint16_t FaultMask;
+#define FAULT_BIT(id) ((FaultMask)1 << (id))
+
+const uint8_t FAULT_NO_LED = 0xFF;
+
+struct FaultDef {
+  const char* name;
+  FaultSeverity severity;
+  bool latching;            // stays active until faultReset(), even if condition clears
+  uint16_t debounceMs;      // condition must be stable this long before it counts
+  uint32_t holdoffMs;       // repeat alert interval while active (0 = alert once)
+  bool blocksOverride;      // E-stop override refused while active
+  bool triggersEstop;       // active fault forces E-stop
+  uint8_t led;              // button-box LED lit while active (unsilenced)
+  uint8_t beeps;            // buzzer pattern on alert
+  void (*report)();         // optional detail printer, may be nullptr
+};
+
+// Detail reporters (implemented by the owning modules)
+void reportOverTemp();
+void reportTempDifferential();
+void reportHeaterDuty();
+void reportProbeMap();
+
+const FaultDef FAULT_TABLE[FAULT_COUNT] = {
+  //  name                  severity            latch  deb   holdoff  block  estop  led           beeps report
+  { "OVER TEMP",           FAULT_SEV_CRITICAL, false,    0,       0, true,  true,  LED_RED,      5, reportOverTemp },
+  { "TEMP DIFFERENTIAL",   FAULT_SEV_WARNING,  false, 1000,   60000, false, false, LED_RED,      2, reportTempDifferential },
+  { "SUMP SENSOR",         FAULT_SEV_WARNING,  false, 2000,   60000, false, false, LED_RED,      1, nullptr },
+  { "DISPLAY SENSOR",      FAULT_SEV_WARNING,  false, 2000,   60000, false, false, LED_RED,      1, nullptr },
+  { "ATO TIMEOUT",         FAULT_SEV_CRITICAL, true,     0,       0, true,  false, LED_RED,      5, nullptr },
+  { "ATO RESERVOIR EMPTY", FAULT_SEV_CRITICAL, false,    0,       0, true,  false, LED_RED,      3, nullptr },
+  { "ATO RUN ANOMALY",     FAULT_SEV_INFO,     false,    0,       0, false, false, FAULT_NO_LED, 0, nullptr },
+  { "HEATER DUTY HIGH",    FAULT_SEV_WARNING,  false,    0, 3600000, false, false, FAULT_NO_LED, 1, reportHeaterDuty },
+  { "IR LINK LOST",        FAULT_SEV_INFO,     false,    0,       0, false, false, FAULT_NO_LED, 1, nullptr },
+  { "PROBE MAP",           FAULT_SEV_WARNING,  false,    0,       0, false, false, FAULT_NO_LED, 2, reportProbeMap },
+};
+
+// One fault owner: the board, or a tank (bit per FaultId)
+struct FaultState {
+  const char* owner;        // tank name, nullptr for the board
+  FaultMask raw;            // conditions as last reported
+  FaultMask stable;         // debounced conditions
+  FaultMask latched;        // latched, awaiting faultReset()
+  FaultMask active;         // stable | latched
+  FaultMask alerted;        // has alerted at least once (for hold-off)
+  unsigned long edgeTime[FAULT_COUNT];
+  unsigned long lastAlert[FAULT_COUNT];
+};
+
+const uint8_t FAULT_SOURCES_MAX = 1 + TANK_MAX;
+
+// External references
+extern bool alarmSilenced;
+
+// Forward declarations
+void soundAlarm(int beeps);
+void triggerFaultStop(FaultState& source);   // main
+
+FaultState faultBoard = {};
+FaultState* faultSources[FAULT_SOURCES_MAX] = { &faultBoard };
+uint8_t faultSourceCount = 1;
+
+// Summary over every source — what everyone reads
+FaultMask faultLatchedMask = 0;
+FaultMask faultActiveMask = 0;
+
+// Function declarations
+void faultRegister(FaultState& state, const char* owner);
+void faultSetCondition(FaultState& state, FaultId id, bool present);
+void faultSetCondition(FaultId id, bool present);
+void evaluateFaults();
+void faultSummarize();
+void faultReset(FaultMask mask);
+bool faultActive(FaultId id);
+FaultMask faultMaskWhere(bool FaultDef::*flag);
+FaultMask faultMaskAtLeast(FaultSeverity severity);
+void printFaults();
+void faultKeyframe(TraceKeyframe& k, FaultState& state);
+
+// ═══════════════════════════════════════════════════════════════
+// TABLE-DERIVED MASKS
+// ═══════════════════════════════════════════════════════════════
+
+FaultMask faultMaskWhere(bool FaultDef::*flag) {
+  FaultMask mask = 0;
+  for (uint8_t i = 0; i < FAULT_COUNT; i++) {
+    if (FAULT_TABLE[i].*flag) mask |= FAULT_BIT(i);
+  }
+  return mask;
+}
+
+FaultMask faultMaskAtLeast(FaultSeverity severity) {
+  FaultMask mask = 0;
+  for (uint8_t i = 0; i < FAULT_COUNT; i++) {
+    if (FAULT_TABLE[i].severity >= severity) mask |= FAULT_BIT(i);
+  }
+  return mask;
+}
+
+// Computed once; the table is const
+const FaultMask FAULT_LATCHING_MASK = faultMaskWhere(&FaultDef::latching);
+const FaultMask FAULT_BLOCKS_OVERRIDE_MASK = faultMaskWhere(&FaultDef::blocksOverride);
+const FaultMask FAULT_ESTOP_MASK = faultMaskWhere(&FaultDef::triggersEstop);
+const FaultMask FAULT_ATTENTION_MASK = faultMaskAtLeast(FAULT_SEV_WARNING);
+
+// ═══════════════════════════════════════════════════════════════
+// FAULT FUNCTIONS
+// ═══════════════════════════════════════════════════════════════
+
+void faultRegister(FaultState& state, const char* owner) {
+  memset(&state, 0, sizeof(state));
+  state.owner = owner;
+  if (faultSourceCount < FAULT_SOURCES_MAX) faultSources[faultSourceCount++] = &state;
+}
+
+void faultSetCondition(FaultState& state, FaultId id, bool present) {
+  FaultMask bit = FAULT_BIT(id);
+  bool was = (state.raw & bit) != 0;
+  if (present == was) return;
+
+  state.edgeTime[id] = ctlMillis();
+  if (present) state.raw |= bit;
+  else state.raw &= ~bit;
+}
+
+// Board-wide condition
+void faultSetCondition(FaultId id, bool present) {
+  faultSetCondition(faultBoard, id, present);
+}
+
+bool faultActive(FaultId id) {
+  return (faultActiveMask & FAULT_BIT(id)) != 0;
+}
+
+void faultPrintName(const FaultState& state, uint8_t id) {
+  Serial.print(FAULT_TABLE[id].name);
+  if (state.owner) Serial.printf(" (%s)", state.owner);
+}
+
+void faultAlert(FaultState& state, uint8_t id) {
+  const FaultDef& def = FAULT_TABLE[id];
+  Serial.print(def.severity == FAULT_SEV_CRITICAL ? "🚨 FAULT: " : "⚠️  FAULT: ");
+  faultPrintName(state, id);
+  Serial.println();
+  if (def.report) def.report();
+  if (def.beeps) soundAlarm(def.beeps);
+  state.lastAlert[id] = ctlMillis();
+  state.alerted |= FAULT_BIT(id);
+}
+
+void faultEvaluate(FaultState& state, unsigned long now) {
+  // Debounce: only bits whose raw value disagrees with the stable value
+  FaultMask pending = state.raw ^ state.stable;
+  FaultMask rising = 0;
+  for (uint8_t i = 0; pending; i++, pending >>= 1) {
+    if (!(pending & 1)) continue;
+    if (now - state.edgeTime[i] < FAULT_TABLE[i].debounceMs) continue;
+    state.stable ^= FAULT_BIT(i);
+    if (state.stable & FAULT_BIT(i)) {
+      rising |= FAULT_BIT(i);
+    } else if (!(state.latched & FAULT_BIT(i))) {
+      Serial.print("✓ Fault cleared: ");
+      faultPrintName(state, i);
+      Serial.println();
+    }
+  }
+
+  state.latched |= state.stable & FAULT_LATCHING_MASK;
+  FaultMask newlyActive = rising & ~state.active;
+  state.active = state.stable | state.latched;
+
+  // Alerts: new faults once; hold-off faults at most once per interval
+  FaultMask active = state.active;
+  for (uint8_t i = 0; active; i++, active >>= 1) {
+    if (!(active & 1)) continue;
+    uint32_t holdoff = FAULT_TABLE[i].holdoffMs;
+    bool due = holdoff
+      ? (!(state.alerted & FAULT_BIT(i)) || now - state.lastAlert[i] >= holdoff)
+      : (newlyActive & FAULT_BIT(i)) != 0;
+    if (due) faultAlert(state, i);
+  }
+}
+
+void faultSummarize() {
+  faultActiveMask = 0;
+  faultLatchedMask = 0;
+  for (uint8_t s = 0; s < faultSourceCount; s++) {
+    faultActiveMask |= faultSources[s]->active;
+    faultLatchedMask |= faultSources[s]->latched;
+  }
+}
+
+// E-stop faults stop their own source: one tank, or the whole board
+void evaluateFaults() {
+  unsigned long now = ctlMillis();
+  for (uint8_t s = 0; s < faultSourceCount; s++) faultEvaluate(*faultSources[s], now);
+  faultSummarize();
+
+  for (uint8_t s = 0; s < faultSourceCount; s++) {
+    if (faultSources[s]->active & FAULT_ESTOP_MASK) triggerFaultStop(*faultSources[s]);
+  }
+}
+
+// Acknowledge latched faults; they drop out once their condition is gone
+void faultReset(FaultMask mask) {
+  for (uint8_t s = 0; s < faultSourceCount; s++) {
+    FaultState& state = *faultSources[s];
+    state.latched &= ~mask;
+    state.active = state.stable | state.latched;
+  }
+  faultSummarize();
+}
+
+void printFaults() {
+  for (uint8_t s = 0; s < faultSourceCount; s++) {
+    const FaultState& state = *faultSources[s];
+    FaultMask active = state.active;
+    for (uint8_t i = 0; active; i++, active >>= 1) {
+      if (!(active & 1)) continue;
+      Serial.print(FAULT_TABLE[i].severity == FAULT_SEV_CRITICAL ? "║ 🚨 " : "║ ⚠️  ");
+      faultPrintName(state, i);
+      if (state.latched & FAULT_BIT(i)) Serial.print(" (latched)");
+      Serial.println();
+    }
+  }
+}
+
+// Debounce and hold-off timing included, so a replay alerts on the same pass
+void faultKeyframe(TraceKeyframe& k, FaultState& state) {
+  k.field(state.raw);
+  k.field(state.stable);
+  k.field(state.latched);
+  k.field(state.active);
+  k.field(state.alerted);
+  for (uint8_t i = 0; i < FAULT_COUNT; i++) {
+    k.ms(state.edgeTime[i]);
+    k.ms(state.lastAlert[i]);
+  }
+}
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include "config.h"
+#include "pin_definitions.h"
+#include "trace.h"
+
+// ═══════════════════════════════════════════════════════════════
+// EVENT-DRIVEN IDLE
+// ═══════════════════════════════════════════════════════════════
+// loop() no longer spins. Each pass ends in idleUntilNextDeadline(),
+// which blocks the loop task until the earliest deadline any module
+// requested (idleRequestDeadline) or until a GPIO interrupt arrives:
+// E-stop, ATO floats, or the button box PCF8574 INT line.
+
+// Wake sources (bitmask)
+const uint8_t WAKE_TIMER  = 0x01;
+const uint8_t WAKE_ESTOP  = 0x02;
+const uint8_t WAKE_FLOAT  = 0x04;
+const uint8_t WAKE_BUTTON = 0x08;
+const uint8_t WAKE_SOURCE_COUNT = 4;
+
+const char* const WAKE_SOURCE_NAMES[WAKE_SOURCE_COUNT] = { "timer", "estop", "float", "button" };
+
+TaskHandle_t idleLoopTask = nullptr;
+volatile uint8_t idlePendingWakes = 0;
+
+unsigned long idleDeadline = 0;
+bool idleDeadlineSet = false;
+
+// Stats (since last idleStatsReset)
+unsigned long idleStatsStart = 0;
+unsigned long idleTimeMs = 0;
+uint32_t idleWakeCounts[WAKE_SOURCE_COUNT];
+
+// Function declarations
+void idleBegin();
+void idleRequestDeadline(unsigned long due);
+void idleUntilNextDeadline();
+uint8_t idleTakeWakes();
+void printIdleStats();
+
+// ═══════════════════════════════════════════════════════════════
+// INTERRUPTS
+// ═══════════════════════════════════════════════════════════════
+
+void IRAM_ATTR idleWakeFromISR(uint8_t source) {
+  idlePendingWakes |= source;
+  BaseType_t woken = pdFALSE;
+  if (idleLoopTask) vTaskNotifyGiveFromISR(idleLoopTask, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+void IRAM_ATTR isrEstop()  { idleWakeFromISR(WAKE_ESTOP); }
+void IRAM_ATTR isrFloat()  { idleWakeFromISR(WAKE_FLOAT); }
+void IRAM_ATTR isrButton() { idleWakeFromISR(WAKE_BUTTON); }
+
+// Call after the GPIOs have their pinMode set
+void idleBegin() {
+  idleLoopTask = xTaskGetCurrentTaskHandle();
+
+  attachInterrupt(digitalPinToInterrupt(ESTOP_BUTTON_PIN), isrEstop, FALLING);
+  // Every other traced pin is a tank's float (registered in TankController::begin)
+  for (uint8_t i = TRACE_PIN_ESTOP + 1; i < tracePinCount; i++) {
+    attachInterrupt(digitalPinToInterrupt(tracePinGpio[i]), isrFloat, CHANGE);
+  }
+#if CFG_BUTTON_BOX_INT_WIRED
+  pinMode(BUTTON_BOX_INT_PIN, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(BUTTON_BOX_INT_PIN), isrButton, FALLING);
+#endif
+
+  idleStatsStart = millis();
+  Serial.println("✓ Event-driven idle enabled");
+}
+
+// ═══════════════════════════════════════════════════════════════
+// DEADLINES
+// ═══════════════════════════════════════════════════════════════
+
+// Ask to be woken no later than `due` (millis). Earliest request wins;
+// requests are cleared after every idle.
+void idleRequestDeadline(unsigned long due) {
+  if (!idleDeadlineSet || (long)(due - idleDeadline) < 0) {
+    idleDeadline = due;
+    idleDeadlineSet = true;
+  }
+}
+
+// Returns and clears the wake sources seen since the last call
+uint8_t idleTakeWakes() {
+  noInterrupts();
+  uint8_t wakes = idlePendingWakes;
+  idlePendingWakes = 0;
+  interrupts();
+  return wakes;
+}
+
+#if CFG_IDLE_LIGHT_SLEEP
+// Light sleep can only wake on levels, so arm each pin for the level
+// it is not at now (i.e. any change)
+void idleArmGpioWake(uint8_t pin) {
+  gpio_wakeup_enable((gpio_num_t)pin, digitalRead(pin) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+}
+
+void idleLightSleep(unsigned long ms) {
+  idleArmGpioWake(ESTOP_BUTTON_PIN);
+  for (uint8_t i = TRACE_PIN_ESTOP + 1; i < tracePinCount; i++) {
+    idleArmGpioWake(tracePinGpio[i]);
+  }
+#if CFG_BUTTON_BOX_INT_WIRED
+  idleArmGpioWake(BUTTON_BOX_INT_PIN);
+#endif
+  esp_sleep_enable_gpio_wakeup();
+  esp_sleep_enable_timer_wakeup((uint64_t)ms * 1000);
+  Serial.flush();
+  esp_light_sleep_start();
+
+  // GPIO wake during light sleep bypasses the ISRs; map it ourselves
+  if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO) {
+    idlePendingWakes |= WAKE_ESTOP | WAKE_FLOAT | WAKE_BUTTON;
+  }
+}
+#endif
+
+void idleUntilNextDeadline() {
+  unsigned long now = millis();
+  unsigned long wait = 0;
+  if (idleDeadlineSet && (long)(idleDeadline - now) > 0) {
+    wait = idleDeadline - now;
+  }
+  idleDeadlineSet = false;
+
+  if (idlePendingWakes != 0) {
+    // Already woken: drop the matching notification, or the next wait
+    // returns at once for an interrupt this pass already handled
+    ulTaskNotifyTake(pdTRUE, 0);
+  } else if (wait > 0) {
+#if CFG_IDLE_LIGHT_SLEEP
+    if (wait >= LIGHT_SLEEP_MIN_MS) {
+      idleLightSleep(wait);
+    } else {
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait));
+    }
+#else
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait));
+#endif
+    idleTimeMs += millis() - now;
+  }
+
+  uint8_t wakes = idlePendingWakes;
+  if (wakes == 0) wakes = WAKE_TIMER;
+  for (uint8_t i = 0; i < WAKE_SOURCE_COUNT; i++) {
+    if (wakes & (1 << i)) idleWakeCounts[i]++;
+  }
+}
+
+// ═══════════════════════════════════════════════════════════════
+// STATS
+// ═══════════════════════════════════════════════════════════════
+
+void idleStatsReset() {
+  idleStatsStart = millis();
+  idleTimeMs = 0;
+  for (uint8_t i = 0; i < WAKE_SOURCE_COUNT; i++) idleWakeCounts[i] = 0;
+}
+
+float idlePercent() {
+  unsigned long span = millis() - idleStatsStart;
+  if (span == 0) return 0;
+  return idleTimeMs * 100.0 / span;
+}
+
+// Prints the window since the last call, then starts a new one
+void printIdleStats() {
+  Serial.print("║ Idle:          ");
+  Serial.print(idlePercent(), 1);
+  Serial.println("%");
+  Serial.print("║ Wakes:         ");
+  for (uint8_t i = 0; i < WAKE_SOURCE_COUNT; i++) {
+    Serial.print(WAKE_SOURCE_NAMES[i]);
+    Serial.print(" ");
+    Serial.print(idleWakeCounts[i]);
+    Serial.print(i + 1 < WAKE_SOURCE_COUNT ? "  " : "\n");
+  }
+  idleStatsReset();
+}
+
+#endif
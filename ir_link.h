@@ -0,0 +1,449 @@
+#ifndef IR_LINK_H
+#define IR_LINK_H
+
+#include <IRremote.hpp>
+#include "config.h"
+#include "pin_definitions.h"
+#include "trace.h"
+#include "faults.h"
+
+// ═══════════════════════════════════════════════════════════════
+// IR TRANSMIT QUEUE + LOOPBACK VERIFY
+// ═══════════════════════════════════════════════════════════════
+// sendIRCommand() only queues. irLinkService() (every pass) sends one
+// frame at a time and waits for its echo on IR_RECV_PIN: the receiver
+// sees our own IR LED, so a frame we decode back went out intact.
+// A frame whose echo never shows up is sent again (up to
+// IR_MAX_ATTEMPTS); an echoed frame is never repeated.
+//
+// Only absolute commands (a mode the fixture jumps to) are resent. A
+// missing echo doesn't prove the fixture missed the frame, and a
+// relative one (channel up/down, power toggle) applied twice is a
+// wrong level. Those are sent once; an unechoed one marks the fixture
+// unverified until an absolute command gets through, and the tank
+// resyncs it (TankController::resyncLights).
+//
+// Until the first echo is seen (or after the link keeps failing) the
+// queue runs open loop: every frame once, IR_FRAME_GAP_MS apart, same
+// spacing the old blocking delays gave.
+//
+// Frames are decoded here from pin-change timestamps rather than by
+// IRremote's receiver, which restarts itself after every send and
+// drops the frame captured during it. Anything else decoded on a
+// fixture address is a press on that fixture's own remote.
+//
+// Each tank's fixture registers its NEC address once
+// (irRegisterAddress) and queues frames by the slot it gets back.
+
+const uint8_t IR_QUEUE_SIZE = 32;
+const uint16_t IR_EDGE_RING = 256;
+const uint8_t IR_STATS_CMDS = 0x20;           // per-command stats for codes below this
+const uint8_t IR_ADDRESS_SLOTS = 4;           // fixtures; 2 bits in the trace record
+const uint8_t IR_SLOT_NONE = 0xFF;
+
+// ctlIrReceive() flags
+const uint8_t IR_RX_OURS   = 0x01;            // address is a registered fixture
+const uint8_t IR_RX_REPEAT = 0x02;            // NEC repeat code (key held)
+const uint8_t IR_RX_SLOT_SHIFT = 2;           // bits 2-3: fixture slot
+
+struct IrFrame {
+  uint8_t slot;            // fixture (irAddresses index)
+  uint8_t command;
+  uint8_t repeats;
+  uint8_t attempts;
+  bool relative;           // effect depends on the fixture's state: never resent
+  uint16_t settleMs;       // extra quiet time the fixture needs after this frame
+};
+
+struct IrCommandStats {
+  uint16_t sent;           // first transmissions
+  uint16_t retries;        // retransmissions after a lost echo
+  uint16_t echoed;         // confirmed delivered
+  uint16_t failed;         // gave up after IR_MAX_ATTEMPTS
+  uint16_t unverified;     // relative, no echo, not resent
+};
+
+enum IrDecodeState : uint8_t {
+  IRD_LEADER_MARK,
+  IRD_LEADER_SPACE,
+  IRD_BIT_MARK,
+  IRD_BIT_SPACE
+};
+
+// Fixture addresses
+uint16_t irAddresses[IR_ADDRESS_SLOTS];
+uint8_t irAddressCount = 0;
+
+// Queue / link state
+IrFrame irQueue[IR_QUEUE_SIZE];
+uint8_t irQueueHead = 0;
+uint8_t irQueueCount = 0;
+bool irAwaitingEcho = false;
+unsigned long irSentAt = 0;
+unsigned long irReadyAt = 0;           // no transmit before this
+bool irLinkVerified = false;           // echoes are being seen
+uint8_t irConsecutiveFails = 0;
+uint8_t irUnverifiedMask = 0;          // per slot: fixture level unknown
+
+// Stats
+IrCommandStats irStats[IR_STATS_CMDS];
+uint32_t irRemotePresses = 0;
+uint16_t irQueueOverflows = 0;
+
+// Edge ring (ISR -> decoder): bit 15 = mark, low bits = duration in µs
+volatile uint16_t irEdges[IR_EDGE_RING];
+volatile uint16_t irEdgeHead = 0;
+uint16_t irEdgeTail = 0;
+volatile unsigned long irLastEdgeUs = 0;
+
+// Decoder
+IrDecodeState irDecState = IRD_LEADER_MARK;
+uint8_t irDecBits = 0;
+uint32_t irDecData = 0;
+uint8_t irDecLastCommand = 0;
+uint8_t irDecLastFlags = 0;
+
+// Forward declarations
+void tankRemotePower(uint8_t slot);  // tank.h
+
+// Function declarations
+void irLinkBegin();
+uint8_t irRegisterAddress(uint16_t address);
+void sendIRCommand(uint8_t slot, uint8_t command, int repeats = 0, bool relative = false);
+void irSettle(unsigned long ms);
+void irLinkService();
+bool irLinkBusy();
+bool irSlotQueued(uint8_t slot);
+bool irSlotUnverified(uint8_t slot);
+unsigned long irLinkDeadline();
+void printIrStats();
+void printIrCommandStats(Print& out);
+void irLinkKeyframe(TraceKeyframe& k);
+
+// ═══════════════════════════════════════════════════════════════
+// RECEIVE: ISR + NEC DECODER
+// ═══════════════════════════════════════════════════════════════
+
+void IRAM_ATTR irEdgePush(unsigned long us, bool mark) {
+  uint16_t next = (irEdgeHead + 1) % IR_EDGE_RING;
+  if (next == irEdgeTail) return;   // full: decoder resyncs on the next leader
+  irEdges[irEdgeHead] = (mark ? 0x8000 : 0) | (us > 0x7FFF ? 0x7FFF : us);
+  irEdgeHead = next;
+}
+
+// Receiver output is LOW during a mark, so the new level says what just ended
+void IRAM_ATTR isrIrEdge() {
+  unsigned long t = micros();
+  irEdgePush(t - irLastEdgeUs, digitalRead(IR_RECV_PIN) == HIGH);
+  irLastEdgeUs = t;
+}
+
+bool irInRange(uint16_t us, uint16_t lo, uint16_t hi) {
+  return us >= lo && us <= hi;
+}
+
+// Leader mark starts a frame from any state
+void irDecodeRestart(bool mark, uint16_t us) {
+  irDecState = (mark && irInRange(us, 7000, 11000)) ? IRD_LEADER_SPACE : IRD_LEADER_MARK;
+}
+
+// Pulls edges until one NEC frame (or repeat code) is complete
+bool irDecodeNext(uint8_t& command, uint8_t& flags) {
+  while (irEdgeTail != irEdgeHead) {
+    uint16_t e = irEdges[irEdgeTail];
+    irEdgeTail = (irEdgeTail + 1) % IR_EDGE_RING;
+    bool mark = e & 0x8000;
+    uint16_t us = e & 0x7FFF;
+
+    switch (irDecState) {
+      case IRD_LEADER_MARK:
+        irDecodeRestart(mark, us);
+        break;
+
+      case IRD_LEADER_SPACE:
+        if (!mark && irInRange(us, 3500, 5500)) {
+          irDecState = IRD_BIT_MARK;
+          irDecBits = 0;
+          irDecData = 0;
+        } else if (!mark && irInRange(us, 1800, 2700)) {
+          irDecState = IRD_BIT_MARK;   // repeat code: just the stop mark follows
+          irDecBits = 0xFF;
+        } else {
+          irDecodeRestart(mark, us);
+        }
+        break;
+
+      case IRD_BIT_MARK:
+        if (!mark || !irInRange(us, 300, 850)) {
+          irDecodeRestart(mark, us);
+          break;
+        }
+        if (irDecBits == 0xFF) {
+          irDecState = IRD_LEADER_MARK;
+          command = irDecLastCommand;
+          flags = irDecLastFlags | IR_RX_REPEAT;
+          return true;
+        }
+        if (irDecBits == 32) {
+          irDecState = IRD_LEADER_MARK;
+          uint8_t a0 = irDecData, a1 = irDecData >> 8, cmd = irDecData >> 16, inv = irDecData >> 24;
+          if ((uint8_t)(cmd ^ inv) != 0xFF) break;   // corrupted
+          uint16_t address = (a1 == (uint8_t)~a0) ? a0 : (a0 | (a1 << 8));
+          irDecLastCommand = cmd;
+          irDecLastFlags = 0;
+          for (uint8_t i = 0; i < irAddressCount; i++) {
+            if (irAddresses[i] == address) irDecLastFlags = IR_RX_OURS | (i << IR_RX_SLOT_SHIFT);
+          }
+          command = cmd;
+          flags = irDecLastFlags;
+          return true;
+        }
+        irDecState = IRD_BIT_SPACE;
+        break;
+
+      case IRD_BIT_SPACE:
+        if (!mark && irInRange(us, 300, 850)) {
+          irDecBits++;
+          irDecState = IRD_BIT_MARK;
+        } else if (!mark && irInRange(us, 1300, 2000)) {
+          irDecData |= (uint32_t)1 << irDecBits;
+          irDecBits++;
+          irDecState = IRD_BIT_MARK;
+        } else {
+          irDecodeRestart(mark, us);
+        }
+        break;
+    }
+  }
+  return false;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// TRANSMIT QUEUE
+// ═══════════════════════════════════════════════════════════════
+
+void irLinkBegin() {
+#if CFG_IR_VERIFY
+  pinMode(IR_RECV_PIN, INPUT);
+  irLastEdgeUs = micros();
+  attachInterrupt(digitalPinToInterrupt(IR_RECV_PIN), isrIrEdge, CHANGE);
+  Serial.println("✓ IR loopback verify enabled");
+#endif
+}
+
+// Same address twice (two tanks, one fixture) shares a slot
+uint8_t irRegisterAddress(uint16_t address) {
+  for (uint8_t i = 0; i < irAddressCount; i++) {
+    if (irAddresses[i] == address) return i;
+  }
+  if (irAddressCount == IR_ADDRESS_SLOTS) {
+    Serial.printf("✗ No IR slot for address 0x%04X (max %u fixtures)\n", address, IR_ADDRESS_SLOTS);
+    return IR_SLOT_NONE;
+  }
+  irAddresses[irAddressCount] = address;
+  return irAddressCount++;
+}
+
+void sendIRCommand(uint8_t slot, uint8_t command, int repeats, bool relative) {
+  if (slot >= irAddressCount) return;
+  if (irQueueCount == IR_QUEUE_SIZE) {
+    irQueueOverflows++;
+    Serial.printf("⚠️  IR queue full, dropped cmd 0x%02X\n", command);
+    return;
+  }
+  IrFrame& f = irQueue[(irQueueHead + irQueueCount) % IR_QUEUE_SIZE];
+  f.slot = slot;
+  f.command = command;
+  f.repeats = repeats;
+  f.attempts = 0;
+  f.relative = relative;
+  f.settleMs = 0;
+  irQueueCount++;
+}
+
+// Fixture needs `ms` of quiet after the last queued frame (power-on, mode change)
+void irSettle(unsigned long ms) {
+  if (irQueueCount > 0) {
+    IrFrame& tail = irQueue[(irQueueHead + irQueueCount - 1) % IR_QUEUE_SIZE];
+    if (ms > tail.settleMs) tail.settleMs = ms;
+  } else if ((long)(ctlMillis() + ms - irReadyAt) > 0) {
+    irReadyAt = ctlMillis() + ms;
+  }
+}
+
+IrCommandStats* irStatsFor(uint8_t command) {
+  static IrCommandStats other;
+  return command < IR_STATS_CMDS ? &irStats[command] : &other;
+}
+
+unsigned long irEchoTimeout(const IrFrame& f) {
+  unsigned long t = IR_ECHO_TIMEOUT_MS + f.repeats * 110UL;
+  if (!irLinkVerified && t < IR_FRAME_GAP_MS) t = IR_FRAME_GAP_MS;
+  return t;
+}
+
+void irPop(unsigned long readyAt) {
+  irQueueHead = (irQueueHead + 1) % IR_QUEUE_SIZE;
+  irQueueCount--;
+  irAwaitingEcho = false;
+  irReadyAt = readyAt;
+}
+
+void irOnEcho(unsigned long now) {
+  IrFrame& f = irQueue[irQueueHead];
+  irStatsFor(f.command)->echoed++;
+  if (!irLinkVerified) Serial.println("✓ IR loopback: echoes seen, delivery verified");
+  irLinkVerified = true;
+  irConsecutiveFails = 0;
+  faultSetCondition(FAULT_IR_LINK, false);
+  if (!f.relative) irUnverifiedMask &= ~(1 << f.slot);
+  irPop(now + IR_ACK_GAP_MS + f.settleMs);
+}
+
+void irOnEchoTimeout(unsigned long now) {
+  IrFrame& f = irQueue[irQueueHead];
+
+  if (!irLinkVerified) {
+    // Open loop: the gap already elapsed while we listened. Nothing
+    // better than an absolute frame sent blind is coming.
+    if (!f.relative) irUnverifiedMask &= ~(1 << f.slot);
+    irPop(now + f.settleMs);
+    return;
+  }
+
+  // Relative frames also wait here; irLinkService drops them after it
+  if (f.attempts < IR_MAX_ATTEMPTS) {
+    irAwaitingEcho = false;
+    irReadyAt = now + IR_RETRY_BACKOFF_MS;   // a late echo in this window still counts
+    return;
+  }
+
+  irStatsFor(f.command)->failed++;
+  irUnverifiedMask |= 1 << f.slot;
+  Serial.printf("⚠️  IR cmd 0x%02X not delivered after %u tries\n", f.command, f.attempts);
+  if (++irConsecutiveFails >= IR_LINK_FAIL_LIMIT) {
+    irLinkVerified = false;
+    faultSetCondition(FAULT_IR_LINK, true);
+  }
+  irPop(now + f.settleMs);
+}
+
+// Relative frame, echo window over: it may or may not have landed
+void irOnUnverified(unsigned long now) {
+  IrFrame& f = irQueue[irQueueHead];
+  irStatsFor(f.command)->unverified++;
+  irUnverifiedMask |= 1 << f.slot;
+  Serial.printf("⚠️  IR cmd 0x%02X not echoed (relative, not resent)\n", f.command);
+  irPop(now + f.settleMs);
+}
+
+void irOnReceive(uint8_t command, uint8_t flags, unsigned long now) {
+  if (!(flags & IR_RX_OURS) || (flags & IR_RX_REPEAT)) return;
+  uint8_t slot = flags >> IR_RX_SLOT_SHIFT;
+
+  // Echo of the head frame, in flight or waiting to be retried
+  const IrFrame& head = irQueue[irQueueHead];
+  if (irQueueCount > 0 && head.attempts > 0 && head.slot == slot && head.command == command) {
+    irOnEcho(now);
+    return;
+  }
+
+  irRemotePresses++;
+  Serial.printf("🎛  Fixture remote: address 0x%04X cmd 0x%02X\n", irAddresses[slot], command);
+  if (command == CMD_POWER) tankRemotePower(slot);   // keep our idea of power in sync
+}
+
+void irTransmit(IrFrame& f, unsigned long now) {
+  if (f.attempts == 0) irStatsFor(f.command)->sent++;
+  else irStatsFor(f.command)->retries++;
+  f.attempts++;
+
+  IrSender.sendNEC(irAddresses[f.slot], f.command, f.repeats);
+  traceOutput(TRACE_IR, f.command, f.repeats);
+  irAwaitingEcho = true;
+  irSentAt = now;
+}
+
+// Every pass: drain decoded frames, time out echoes, send the next frame
+void irLinkService() {
+  unsigned long now = ctlMillis();
+
+  uint8_t command, flags;
+  while (ctlIrReceive(command, flags)) {
+    irOnReceive(command, flags, now);
+  }
+
+  if (irAwaitingEcho && now - irSentAt >= irEchoTimeout(irQueue[irQueueHead])) {
+    irOnEchoTimeout(now);
+  }
+
+  if (!irAwaitingEcho && irQueueCount > 0 && (long)(now - irReadyAt) >= 0) {
+    IrFrame& head = irQueue[irQueueHead];
+    if (head.relative && head.attempts > 0) irOnUnverified(now);
+    else irTransmit(head, now);
+  }
+}
+
+bool irLinkBusy() {
+  return irAwaitingEcho || irQueueCount > 0;
+}
+
+bool irSlotQueued(uint8_t slot) {
+  for (uint8_t i = 0; i < irQueueCount; i++) {
+    if (irQueue[(irQueueHead + i) % IR_QUEUE_SIZE].slot == slot) return true;
+  }
+  return false;
+}
+
+bool irSlotUnverified(uint8_t slot) {
+  return slot < IR_ADDRESS_SLOTS && (irUnverifiedMask & (1 << slot));
+}
+
+// When the loop should next run for the IR link
+unsigned long irLinkDeadline() {
+  if (irAwaitingEcho) return ctlMillis() + IR_ECHO_POLL_MS;
+  return irReadyAt;
+}
+
+// Keyframes are only taken with the queue empty, which leaves the
+// pacing and the link's verified/failing state
+void irLinkKeyframe(TraceKeyframe& k) {
+  k.ms(irReadyAt);
+  k.field(irLinkVerified);
+  k.field(irConsecutiveFails);
+  k.field(irUnverifiedMask);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// STATS
+// ═══════════════════════════════════════════════════════════════
+
+void printIrStats() {
+  uint32_t sent = 0, retries = 0, echoed = 0, failed = 0;
+  for (uint8_t i = 0; i < IR_STATS_CMDS; i++) {
+    sent += irStats[i].sent;
+    retries += irStats[i].retries;
+    echoed += irStats[i].echoed;
+    failed += irStats[i].failed;
+  }
+  Serial.print("║ IR Link:       ");
+  Serial.print(irLinkVerified ? "verified" : "open loop");
+  Serial.printf("  %lu sent  %lu ok  %lu retry  %lu fail\n",
+                (unsigned long)sent, (unsigned long)echoed, (unsigned long)retries, (unsigned long)failed);
+  if (irRemotePresses) {
+    Serial.print("║ Remote presses: ");
+    Serial.println(irRemotePresses);
+  }
+}
+
+// One line per command that has been used
+void printIrCommandStats(Print& out) {
+  for (uint8_t i = 0; i < IR_STATS_CMDS; i++) {
+    const IrCommandStats& s = irStats[i];
+    if (!s.sent) continue;
+    out.printf("IR cmd=0x%02X sent=%u retries=%u echoed=%u failed=%u unverified=%u\n",
+               i, s.sent, s.retries, s.echoed, s.failed, s.unverified);
+  }
+}
+
+#endif
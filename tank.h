@@ -0,0 +1,459 @@
+#ifndef TANK_H
+#define TANK_H
+
+#include "config.h"
+#include "pin_definitions.h"
+#include "trace.h"
+#include "faults.h"
+#include "ato_stats.h"
+#include "ir_link.h"
+
+// ═══════════════════════════════════════════════════════════════
+// TANK CONTROLLER
+// ═══════════════════════════════════════════════════════════════
+// Everything that belongs to one tank: probes, heaters, ATO, feed
+// mode, lighting schedule, clouds and its own faults. One instance per
+// TANK_CONFIGS entry, all driven from runTick(). The methods live with
+// their subsystem (temperature.h, ato.h, lighting.h); this header has
+// the state and the board-level glue: E-stop fan-out and warm-restart
+// snapshots.
+//
+// A fault stop (faultStop) shuts down only the tank whose fault it is;
+// the manual E-stop (emergencyStop) stops them all.
+//
+// Instances never own a bus, so adding a tank only adds its own
+// handlers to the tick: probes are read through the probe network
+// (temperature.h), IR frames share one queue, relays share one expander.
+
+// Light modes
+enum LightMode {
+  NIGHT_MODE,
+  SUNRISE_RAMPING,
+  FULL_DAYLIGHT,
+  SUNSET_RAMPING
+};
+
+// Cloud states
+enum CloudState {
+  NO_CLOUD,
+  CLOUD_DIMMING,
+  CLOUD_HOLDING,
+  CLOUD_BRIGHTENING
+};
+
+const uint8_t TEMP_PROBE_NONE = 0xFF;
+
+// Per-tank part of the RTC snapshot (see watchdog.h)
+struct TankSnapshot {
+  bool feedModeActive;
+  bool photoModeActive;
+  bool scheduledLightsEnabled;
+  bool lightsOn;
+  bool heaterPrimaryOn;
+  bool heaterBackupOn;
+  bool atoTimeoutAlarm;
+  bool atoReservoirAlarm;
+  bool faultStop;
+  uint16_t faultLatched;
+  uint8_t lightMode;
+  int16_t rampStep;
+  uint32_t feedElapsedMs;
+  uint32_t rampElapsedMs;
+  float targetTemp;
+  float hysteresis;
+  uint32_t feedDurationMs;
+};
+
+class TankController {
+public:
+  const TankConfig* cfg = nullptr;
+  uint8_t index = 0;
+
+  // Settings: start from the config, adjustable from the console
+  float targetTemp = 0;
+  float hysteresis = 0;
+  unsigned long feedDurationMs = FEED_MODE_DURATION;
+
+  // Temperature (°F)
+  uint8_t probeControl = TEMP_PROBE_NONE;
+  uint8_t probeReference = TEMP_PROBE_NONE;
+  bool tempValid = false;          // control probe reading usable (tempProbeReady)
+  float tempControl = 0;
+  float tempReference = 0;
+  bool heaterPrimaryOn = false;
+  bool heaterBackupOn = false;
+
+  // ATO
+  TracePin pinFloatLow = TRACE_PIN_NONE;
+  TracePin pinFloatHigh = TRACE_PIN_NONE;
+  TracePin pinReservoir = TRACE_PIN_NONE;
+  unsigned long atoStartTime = 0;
+  unsigned long atoLastRunTime = 0;
+  bool atoRunning = false;
+  bool atoTimeoutAlarm = false;
+  bool atoReservoirAlarm = false;
+  AtoStats atoStats = {};
+
+  // Modes
+  bool feedModeActive = false;
+  bool photoModeActive = false;
+  unsigned long feedModeStartTime = 0;
+
+  // Lighting
+  uint8_t irSlot = IR_SLOT_NONE;
+  LightMode currentLightMode = NIGHT_MODE;
+  bool scheduledLightsEnabled = true;
+  bool lightsOn = false;
+  unsigned long rampStartTime = 0;
+  int currentRampStep = 0;
+  int scheduleDay = -1;
+  bool sunriseStartedToday = false;
+  bool sunsetStartedToday = false;
+
+  // Clouds
+  CloudState cloudState = NO_CLOUD;
+  unsigned long nextCloudTime = 0;
+  unsigned long cloudStartTime = 0;
+  unsigned long cloudDuration = 0;
+  int cloudDimSteps = 0;
+  int cloudBrightenSteps = 0;
+  unsigned long lastCloudStepTime = 0;
+
+  // Faults
+  FaultState faults = {};
+  bool faultStop = false;          // stopped by one of its own faults
+
+  // tank.h
+  void begin(const TankConfig& config, uint8_t idx);
+  void start();
+  void setCondition(FaultId id, bool present);
+  bool stopped() const;
+  void setOutput(uint8_t relay, bool on);
+  void setGyreRunning(bool run);
+  void enterEstop();
+  void runDefaults();
+  void toggleFeedMode();
+  void handleFeedMode();
+  void togglePhotoMode();
+  void save(TankSnapshot& s) const;
+  void restore(const TankSnapshot& s, unsigned long now);
+  void keyframe(TraceKeyframe& k);
+
+  // temperature.h
+  bool hasReference() const { return probeReference != TEMP_PROBE_NONE; }
+  void readTemperatures();
+  void checkTemperatureDifferential();
+  void checkEmergencyShutoff();
+  bool overTempFaultActive() const;
+  void controlHeaters();
+
+  // ato.h
+  bool hasATO() const { return pinFloatLow != TRACE_PIN_NONE && pinFloatHigh != TRACE_PIN_NONE; }
+  void handleATO();
+  void resetATOAlarm();
+
+  // lighting.h
+  void sendIR(uint8_t command, bool relative = false);
+  void setLightPower(bool on);
+  void setLightMode(uint8_t mode);
+  void adjustChannel(uint8_t channel, int steps);
+  void setNightMode();
+  void lightsFullBright();
+  void lightsPhotoMode();
+  void lightsNormalMode();
+  void setInitialLightingFromTime();
+  void handleLightingSchedule();
+  void startSunrise();
+  void updateSunrise();
+  void completeSunrise();
+  void startSunset();
+  void updateSunset();
+  void completeSunset();
+  void handleClouds();
+  void startCloud();
+  void startCloudBrighten();
+  void updateCloudBrighten();
+  void triggerManualCloud();
+  void scheduleNextCloud();
+  void resyncLights();
+};
+
+TankController tanks[TANK_MAX];
+uint8_t tankCount = 0;
+
+// Heater relays of every tank, for the energy duty alert (energy.h)
+extern uint8_t energyHeaterMask;
+
+// External references
+extern bool emergencyStop;
+
+// Forward declarations
+void setRelay(uint8_t relay, bool state);
+uint8_t tempProbeAdd(const TankProbe& probe, const char* owner, const char* role);   // temperature.h
+
+// Function declarations
+TankController* tankAdd(const TankConfig& config);
+TankController& panelTank();
+TankController* tankForFaults(const FaultState& state);
+bool tanksAnyStopped();
+void tankRemotePower(uint8_t slot);
+
+// ═══════════════════════════════════════════════════════════════
+// REGISTRY
+// ═══════════════════════════════════════════════════════════════
+
+// Binds the next free instance to a config. Cold-start behaviour
+// (lights from the clock, pumps on) is start(), so the warm path can
+// restore a snapshot instead.
+TankController* tankAdd(const TankConfig& config) {
+  if (tankCount == TANK_MAX) {
+    Serial.printf("✗ Tank '%s' not added (TANK_MAX = %u)\n", config.name, TANK_MAX);
+    return nullptr;
+  }
+  TankController& t = tanks[tankCount];
+  t.begin(config, tankCount);
+  tankCount++;
+  return &t;
+}
+
+// The button box and LEDs belong to the first tank
+TankController& panelTank() {
+  return tanks[0];
+}
+
+// Owner of a fault source; nullptr for faultBoard
+TankController* tankForFaults(const FaultState& state) {
+  for (uint8_t i = 0; i < tankCount; i++) {
+    if (&tanks[i].faults == &state) return &tanks[i];
+  }
+  return nullptr;
+}
+
+// Manual E-stop, or any tank's own fault stop
+bool tanksAnyStopped() {
+  for (uint8_t i = 0; i < tankCount; i++) {
+    if (tanks[i].stopped()) return true;
+  }
+  return false;
+}
+
+// POWER pressed on a fixture's own remote
+void tankRemotePower(uint8_t slot) {
+  for (uint8_t i = 0; i < tankCount; i++) {
+    if (tanks[i].irSlot == slot) tanks[i].lightsOn = !tanks[i].lightsOn;
+  }
+}
+
+// ═══════════════════════════════════════════════════════════════
+// INSTANCE
+// ═══════════════════════════════════════════════════════════════
+
+void TankController::begin(const TankConfig& config, uint8_t idx) {
+  cfg = &config;
+  index = idx;
+  targetTemp = cfg->targetTemp;
+  hysteresis = cfg->hysteresis;
+
+  probeControl = tempProbeAdd(cfg->control, cfg->name, "control");
+  probeReference = tempProbeAdd(cfg->reference, cfg->name, "reference");
+
+  if (cfg->floats.low != PIN_NONE && cfg->floats.high != PIN_NONE) {
+    pinMode(cfg->floats.low, INPUT_PULLUP);
+    pinMode(cfg->floats.high, INPUT_PULLUP);
+    pinFloatLow = traceRegisterPin(cfg->floats.low);
+    pinFloatHigh = traceRegisterPin(cfg->floats.high);
+    if (cfg->floats.reservoir != PIN_NONE) {
+      pinMode(cfg->floats.reservoir, INPUT_PULLUP);
+      pinReservoir = traceRegisterPin(cfg->floats.reservoir);
+    }
+  }
+
+  if (cfg->lights) irSlot = irRegisterAddress(cfg->irAddress);
+  faultRegister(faults, cfg->name);
+
+  if (cfg->relays.heaterPrimary != RELAY_NONE) energyHeaterMask |= 1 << cfg->relays.heaterPrimary;
+  if (cfg->relays.heaterBackup != RELAY_NONE) energyHeaterMask |= 1 << cfg->relays.heaterBackup;
+
+  Serial.printf("✓ Tank %u '%s': %s%s%s (%u bytes)\n", index, cfg->name,
+                hasReference() ? "2 probes" : "1 probe",
+                hasATO() ? ", ATO" : "",
+                cfg->lights ? ", lights" : "",
+                (unsigned)sizeof(TankController));
+}
+
+// Cold start: lights from the clock, circulation on, first cloud scheduled
+void TankController::start() {
+  setInitialLightingFromTime();
+  runDefaults();
+  scheduleNextCloud();
+}
+
+void TankController::setCondition(FaultId id, bool present) {
+  faultSetCondition(faults, id, present);
+}
+
+bool TankController::stopped() const {
+  return emergencyStop || faultStop;
+}
+
+// Outputs a tank does not have are RELAY_NONE and silently skipped
+void TankController::setOutput(uint8_t relay, bool on) {
+  if (relay != RELAY_NONE) setRelay(relay, on);
+}
+
+// Intent-based gyre control (so you don't invert logic everywhere)
+void TankController::setGyreRunning(bool run) {
+  if (CFG_GYRE_WIRED_NC) {
+    setOutput(cfg->relays.gyre, !run);   // relay ON cuts power, relay OFF allows power through NC
+  } else {
+    setOutput(cfg->relays.gyre, run);    // relay ON provides power via NO
+  }
+}
+
+// E-stop outputs; circulation keeps running
+void TankController::enterEstop() {
+  setOutput(cfg->relays.returnPump, false);
+  setOutput(cfg->relays.heaterPrimary, false);
+  setOutput(cfg->relays.heaterBackup, false);
+  setOutput(cfg->relays.atoPump, false);
+  setNightMode();
+  setGyreRunning(true);
+}
+
+// Known-good RUN baseline (boot, E-stop exit)
+void TankController::runDefaults() {
+  feedModeActive = false;
+  photoModeActive = false;
+  setOutput(cfg->relays.returnPump, true);
+  setGyreRunning(true);
+}
+
+void TankController::toggleFeedMode() {
+  if (feedModeActive) {
+    feedModeActive = false;
+    setOutput(cfg->relays.returnPump, true);
+    setGyreRunning(true);
+    Serial.printf("🐟 %s: feed mode OFF (manual)\n", cfg->name);
+  } else {
+    feedModeActive = true;
+    feedModeStartTime = ctlMillis();
+    setOutput(cfg->relays.returnPump, false);
+    setGyreRunning(false);
+    Serial.printf("🐟 %s: feed mode ON (%lu minutes)\n", cfg->name, feedDurationMs / 60000);
+    tone(BUZZER_PIN, 1500, 100);
+  }
+}
+
+void TankController::handleFeedMode() {
+  if (feedModeActive) {
+    if (ctlMillis() - feedModeStartTime >= feedDurationMs) {
+      feedModeActive = false;
+      setOutput(cfg->relays.returnPump, true);
+      setGyreRunning(true);
+      Serial.printf("🐟 %s: feed mode ended (timeout)\n", cfg->name);
+      tone(BUZZER_PIN, 2000, 100);
+      delay(150);
+      tone(BUZZER_PIN, 2000, 100);
+    }
+  }
+}
+
+void TankController::togglePhotoMode() {
+  photoModeActive = !photoModeActive;
+
+  if (photoModeActive) {
+    lightsPhotoMode();
+  } else {
+    lightsNormalMode();
+  }
+}
+
+// ═══════════════════════════════════════════════════════════════
+// SNAPSHOT
+// ═══════════════════════════════════════════════════════════════
+
+void TankController::save(TankSnapshot& s) const {
+  s.feedModeActive = feedModeActive;
+  s.photoModeActive = photoModeActive;
+  s.scheduledLightsEnabled = scheduledLightsEnabled;
+  s.lightsOn = lightsOn;
+  s.heaterPrimaryOn = heaterPrimaryOn;
+  s.heaterBackupOn = heaterBackupOn;
+  s.atoTimeoutAlarm = atoTimeoutAlarm;
+  s.atoReservoirAlarm = atoReservoirAlarm;
+  s.faultStop = faultStop;
+  s.faultLatched = faults.latched;
+  s.lightMode = (uint8_t)currentLightMode;
+  s.rampStep = currentRampStep;
+  s.feedElapsedMs = feedModeActive ? ctlMillis() - feedModeStartTime : 0;
+  s.rampElapsedMs = ctlMillis() - rampStartTime;
+  s.targetTemp = targetTemp;
+  s.hysteresis = hysteresis;
+  s.feedDurationMs = feedDurationMs;
+}
+
+void TankController::restore(const TankSnapshot& s, unsigned long now) {
+  feedModeActive = s.feedModeActive;
+  photoModeActive = s.photoModeActive;
+  scheduledLightsEnabled = s.scheduledLightsEnabled;
+  lightsOn = s.lightsOn;
+  heaterPrimaryOn = s.heaterPrimaryOn;
+  heaterBackupOn = s.heaterBackupOn;
+  atoTimeoutAlarm = s.atoTimeoutAlarm;
+  atoReservoirAlarm = s.atoReservoirAlarm;
+  faultStop = s.faultStop;
+  faults.latched = s.faultLatched;
+  faults.active = faults.stable | faults.latched;
+  currentLightMode = (LightMode)s.lightMode;
+  currentRampStep = s.rampStep;
+  feedModeStartTime = now - s.feedElapsedMs;
+  rampStartTime = now - s.rampElapsedMs;
+  targetTemp = s.targetTemp;
+  hysteresis = s.hysteresis;
+  feedDurationMs = s.feedDurationMs;
+  setCondition(FAULT_ATO_TIMEOUT, atoTimeoutAlarm);
+  scheduleNextCloud();
+}
+
+// Trace keyframe: unlike the RTC snapshot this is everything the tick
+// handlers read back, timers, cloud state and the ATO drift state behind
+// FAULT_ATO_ANOMALY included, so a replay seeded from it makes the same
+// decisions
+void TankController::keyframe(TraceKeyframe& k) {
+  k.field(targetTemp);
+  k.field(hysteresis);
+  k.ms(feedDurationMs);
+  k.field(tempValid);
+  k.field(tempControl);
+  k.field(tempReference);
+  k.field(heaterPrimaryOn);
+  k.field(heaterBackupOn);
+  k.ms(atoStartTime);
+  k.ms(atoLastRunTime);
+  k.field(atoRunning);
+  atoStatsKeyframe(k, atoStats);
+  k.field(atoTimeoutAlarm);
+  k.field(atoReservoirAlarm);
+  k.field(feedModeActive);
+  k.field(photoModeActive);
+  k.ms(feedModeStartTime);
+  k.field(currentLightMode);
+  k.field(scheduledLightsEnabled);
+  k.field(lightsOn);
+  k.ms(rampStartTime);
+  k.field(currentRampStep);
+  k.field(scheduleDay);
+  k.field(sunriseStartedToday);
+  k.field(sunsetStartedToday);
+  k.field(cloudState);
+  k.ms(nextCloudTime);
+  k.ms(cloudStartTime);
+  k.ms(cloudDuration);
+  k.field(cloudDimSteps);
+  k.field(cloudBrightenSteps);
+  k.ms(lastCloudStepTime);
+  faultKeyframe(k, faults);
+  k.field(faultStop);
+}
+
+#endif
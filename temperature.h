@@ -1,132 +1,493 @@
-#ifndef TEMPERATURE_H
-#define TEMPERATURE_H
-
-#include <OneWire.h>
-#include <DallasTemperature.h>
-#include "config.h"
-#include "pin_definitions.h"
-
-// External references
-extern OneWire oneWireSump;
-extern OneWire oneWireDisplay;
-extern DallasTemperature sensorSump;
-extern DallasTemperature sensorDisplay;
-extern float tempSump;
-extern float tempDisplay;
-extern bool heaterPrimaryOn;
-extern bool heaterBackupOn;
-extern bool emergencyStop;
-
-// Forward declarations
-void triggerFaultStop();  // NEW
-bool overTempFaultActive(); // NEW
-void setRelay(uint8_t relay, bool state);
-void soundAlarm(int beeps);
-
-// Function declarations
-void readTemperatures();
-void checkTemperatureDifferential();
-void checkEmergencyShutoff();
-void controlHeaters();
-
-// ═══════════════════════════════════════════════════════════════
-// TEMPERATURE FUNCTIONS
-// ═══════════════════════════════════════════════════════════════
-
-void readTemperatures() {
-  sensorSump.requestTemperatures();
-  sensorDisplay.requestTemperatures();
-  
-  float tempSumpC = sensorSump.getTempCByIndex(0);
-  float tempDisplayC = sensorDisplay.getTempCByIndex(0);
-  
-  tempSump = (tempSumpC * 9.0 / 5.0) + 32.0;
-  tempDisplay = (tempDisplayC * 9.0 / 5.0) + 32.0;
-  
-  if (tempSump < -100 || tempSump > 150) {
-    Serial.println("⚠️  WARNING: Sump temp sensor error!");
-  }
-  if (tempDisplay < -100 || tempDisplay > 150) {
-    Serial.println("⚠️  WARNING: Display temp sensor error!");
-  }
-}
-
-void checkTemperatureDifferential() {
-  static unsigned long lastAlert = 0;
-  
-  float diff = abs(tempSump - tempDisplay);
-  
-  if (diff > TEMP_DIFFERENTIAL_ALERT) {
-    if (millis() - lastAlert > 60000) {
-      Serial.println("⚠️  WARNING: Temperature differential!");
-      Serial.print("   Sump: ");
-      Serial.print(tempSump, 1);
-      Serial.print("°F  Display: ");
-      Serial.print(tempDisplay, 1);
-      Serial.print("°F  Diff: ");
-      Serial.print(diff, 1);
-      Serial.println("°F");
-      soundAlarm(2);
-      lastAlert = millis();
-    }
-  }
-}
-
-bool overTempFaultActive() {
-  return (tempSump >= TEMP_EMERGENCY_HIGH) || (tempDisplay >= TEMP_EMERGENCY_HIGH);
-}
-
-void checkEmergencyShutoff() {
-  if (overTempFaultActive()) {
-    if (!emergencyStop) {
-      Serial.println("🚨 EMERGENCY - Temperature too high!");
-      Serial.print("   Sump: ");
-      Serial.print(tempSump, 1);
-      Serial.print("°F  Display: ");
-      Serial.print(tempDisplay, 1);
-      Serial.println("°F");
-      triggerFaultStop();
-    }
-  }
-}
-
-void controlHeaters() {
-  if (emergencyStop) {
-    if (heaterPrimaryOn) {
-      setRelay(RELAY_HEATER_PRIMARY, false);
-      heaterPrimaryOn = false;
-    }
-    if (heaterBackupOn) {
-      setRelay(RELAY_HEATER_BACKUP, false);
-      heaterBackupOn = false;
-    }
-    return;
-  }
-  
-  float controlTemp = tempSump;
-  
-  if (controlTemp < (TARGET_TEMP - TEMP_HYSTERESIS)) {
-    if (!heaterPrimaryOn) {
-      setRelay(RELAY_HEATER_PRIMARY, true);
-      heaterPrimaryOn = true;
-      Serial.print("✓ Primary heater ON (");
-      Serial.print(controlTemp, 1);
-      Serial.println("°F)");
-    }
-  } else if (controlTemp > (TARGET_TEMP + TEMP_HYSTERESIS)) {
-    if (heaterPrimaryOn) {
-      setRelay(RELAY_HEATER_PRIMARY, false);
-      heaterPrimaryOn = false;
-      Serial.print("✓ Primary heater OFF (");
-      Serial.print(controlTemp, 1);
-      Serial.println("°F)");
-    }
-  }
-  
-  if (heaterBackupOn) {
-    setRelay(RELAY_HEATER_BACKUP, false);
-    heaterBackupOn = false;
-  }
-}
-
-#endif
\ No newline at end of file
+#ifndef TEMPERATURE_H
+#define TEMPERATURE_H
+
+#include <OneWire.h>
+#include "config.h"
+#include "pin_definitions.h"
+#include "trace.h"
+#include "faults.h"
+#include "tank.h"
+
+// ═══════════════════════════════════════════════════════════════
+// PROBE NETWORK
+// ═══════════════════════════════════════════════════════════════
+// tempBegin() searches every OneWire bus and keeps the DS18B20 ROMs it
+// finds, and asks each bus whether any probe on it is parasite-powered.
+// Tanks and TEMP_ROLES then claim them: by ROM, or with an all-zero ROM
+// the one device on that bus that no config names. If there is not
+// exactly one, the wildcard is refused (FAULT_PROBE_MAP) rather than
+// guessed, and the ROMs found are printed to paste into the config.
+//
+// Acquisition never blocks. One tick sends a single skip-ROM CONVERT T
+// per bus, so every probe on it converts at once; the first tick after
+// TEMP_CONVERSION_MS reads each probe's scratchpad by ROM, checks its
+// CRC and starts the next round. A probe added to a bus costs one
+// ~12 ms scratchpad read, not another 750 ms conversion or another GPIO.
+// On a parasite bus CONVERT T is sent with the strong pullup on, and
+// nothing else uses that bus until the conversion time is up.
+
+const uint8_t TEMP_DEVICE_MAX = 16;              // ROMs kept from the boot search
+const unsigned long TEMP_CONVERSION_MS = 750;    // DS18B20 at 12 bits
+const uint8_t TEMP_BAD_READS_MAX = 3;            // in a row before a probe reads as disconnected
+const float TEMP_DISCONNECTED_C = -127.0;
+
+const uint8_t DS18B20_FAMILY = 0x28;
+const uint8_t DS18B20_CONVERT_T = 0x44;
+const uint8_t DS18B20_READ_SCRATCHPAD = 0xBE;
+const uint8_t DS18B20_READ_POWER_SUPPLY = 0xB4;  // parasite devices pull the read slot low
+const int16_t DS18B20_POWER_ON_RAW = 0x0550;     // 85 °C: reset value, no conversion happened
+
+struct TempDevice {
+  uint8_t bus;
+  uint8_t addr[8];
+  bool claimed;
+};
+
+struct TempProbe {
+  uint8_t bus;
+  uint8_t addr[8];
+  const char* owner;        // tank name, or nullptr for a TEMP_ROLES entry
+  const char* role;
+  bool found;               // ROM was on the bus at boot
+  bool seen;                // has at least one reading
+  uint8_t badReads;         // consecutive failed reads
+  uint16_t crcErrors;       // lifetime: scratchpad failed its checks
+  uint16_t presenceErrors;  // lifetime: no presence pulse on reset
+  float tempC;
+};
+
+// tempReadScratchpad() outcome
+enum TempRead : uint8_t {
+  TEMP_READ_OK,
+  TEMP_READ_NO_PRESENCE,    // nothing answered the reset
+  TEMP_READ_BAD_PAD,        // CRC, fixed bits or all-zero pad
+  TEMP_READ_POWER_ON        // 85 °C reset value: the conversion never ran
+};
+
+// External references
+extern OneWire tempBuses[TEMP_BUS_COUNT];
+
+TempDevice tempDevices[TEMP_DEVICE_MAX];
+uint8_t tempDeviceCount = 0;
+TempProbe tempProbes[TEMP_PROBE_MAX];
+uint8_t tempProbeCount = 0;
+unsigned long tempBusStarted[TEMP_BUS_COUNT];
+bool tempBusConverting[TEMP_BUS_COUNT];
+bool tempBusParasite[TEMP_BUS_COUNT];
+
+// Function declarations
+void tempBegin();
+uint8_t tempProbeAdd(const TankProbe& probe, const char* owner, const char* role);
+void tempMapRoles();
+void tempService();
+void tempKeyframe(TraceKeyframe& k);
+bool tempProbeReady(uint8_t probe);
+bool tempProbeFailed(uint8_t probe);
+float tempProbeF(uint8_t probe);
+void printTempProbes(Print& out);
+void reportOverTemp();
+void reportTempDifferential();
+void reportProbeMap();
+
+void tempPrintRom(Print& out, const uint8_t* addr) {
+  for (uint8_t i = 0; i < 8; i++) out.printf(i ? ":%02X" : "%02X", addr[i]);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// DISCOVERY
+// ═══════════════════════════════════════════════════════════════
+
+// READ POWER SUPPLY to every device at once: a parasite-powered one
+// answers with a 0 in the read slot
+bool tempBusIsParasite(uint8_t bus) {
+  OneWire& w = tempBuses[bus];
+  if (!w.reset()) return false;
+  w.skip();
+  w.write(DS18B20_READ_POWER_SUPPLY);
+  return w.read_bit() == 0;
+}
+
+void tempBegin() {
+  uint8_t addr[8];
+  for (uint8_t b = 0; b < TEMP_BUS_COUNT; b++) {
+    tempBusConverting[b] = false;
+    uint8_t found = 0;
+    tempBuses[b].reset_search();
+    while (tempBuses[b].search(addr)) {
+      if (OneWire::crc8(addr, 7) != addr[7]) continue;   // garbled search, skip it
+      if (addr[0] != DS18B20_FAMILY) continue;
+      if (tempDeviceCount == TEMP_DEVICE_MAX) {
+        Serial.printf("✗ More than %u probes, ignoring the rest\n", TEMP_DEVICE_MAX);
+        break;
+      }
+      TempDevice& d = tempDevices[tempDeviceCount++];
+      d.bus = b;
+      memcpy(d.addr, addr, 8);
+      d.claimed = false;
+      found++;
+    }
+    tempBusParasite[b] = found && tempBusIsParasite(b);
+    Serial.printf("  OneWire bus %u: %u probe(s)%s\n", b, found, tempBusParasite[b] ? ", parasite power" : "");
+  }
+}
+
+bool tempRomIsZero(const uint8_t* addr) {
+  for (uint8_t i = 0; i < 8; i++) {
+    if (addr[i]) return false;
+  }
+  return true;
+}
+
+// True if some config claims this ROM explicitly
+bool tempRomConfigured(uint8_t bus, const uint8_t* addr) {
+  for (uint8_t i = 0; i < TANK_CONFIG_COUNT; i++) {
+    const TankConfig& c = TANK_CONFIGS[i];
+    if (c.control.bus == bus && memcmp(c.control.addr, addr, 8) == 0) return true;
+    if (c.reference.bus == bus && memcmp(c.reference.addr, addr, 8) == 0) return true;
+  }
+  for (uint8_t i = 0; i < TEMP_ROLE_COUNT; i++) {
+    const TankProbe& p = TEMP_ROLES[i].probe;
+    if (p.bus == bus && memcmp(p.addr, addr, 8) == 0) return true;
+  }
+  return false;
+}
+
+// Free for an all-zero ROM: unclaimed, and no config names it
+bool tempDeviceUnnamed(const TempDevice& d) {
+  return !d.claimed && !tempRomConfigured(d.bus, d.addr);
+}
+
+// Device for a configured probe: exact ROM, or the bus's only unnamed
+// one. candidates is how many an all-zero ROM could have meant.
+int8_t tempDeviceFor(const TankProbe& probe, uint8_t& candidates) {
+  bool any = tempRomIsZero(probe.addr);
+  int8_t match = -1;
+  candidates = 0;
+  for (uint8_t i = 0; i < tempDeviceCount; i++) {
+    const TempDevice& d = tempDevices[i];
+    if (d.bus != probe.bus) continue;
+    if (!any) {
+      if (memcmp(d.addr, probe.addr, 8) == 0) return i;
+    } else if (tempDeviceUnnamed(d)) {
+      match = i;
+      candidates++;
+    }
+  }
+  return candidates == 1 ? match : -1;
+}
+
+// Unnamed devices on one bus, one ROM per line
+void tempPrintUnnamed(Print& out, uint8_t bus) {
+  for (uint8_t i = 0; i < tempDeviceCount; i++) {
+    const TempDevice& d = tempDevices[i];
+    if (d.bus != bus || !tempDeviceUnnamed(d)) continue;
+    out.print("    ");
+    tempPrintRom(out, d.addr);
+    out.println();
+  }
+}
+
+// Same ROM as an existing probe shares its channel
+uint8_t tempProbeAdd(const TankProbe& probe, const char* owner, const char* role) {
+  if (probe.bus >= TEMP_BUS_COUNT) return TEMP_PROBE_NONE;
+
+  uint8_t candidates;
+  int8_t dev = tempDeviceFor(probe, candidates);
+  const uint8_t* addr = dev >= 0 ? tempDevices[dev].addr : probe.addr;
+
+  for (uint8_t i = 0; i < tempProbeCount; i++) {
+    TempProbe& p = tempProbes[i];
+    if (p.bus == probe.bus && memcmp(p.addr, addr, 8) == 0) return i;
+  }
+  if (tempProbeCount == TEMP_PROBE_MAX) {
+    Serial.printf("✗ No room for another probe (max %u)\n", TEMP_PROBE_MAX);
+    return TEMP_PROBE_NONE;
+  }
+
+  TempProbe& p = tempProbes[tempProbeCount];
+  p.bus = probe.bus;
+  memcpy(p.addr, addr, 8);
+  p.owner = owner;
+  p.role = role;
+  p.found = dev >= 0;
+  p.seen = false;
+  p.badReads = 0;
+  p.crcErrors = 0;
+  p.presenceErrors = 0;
+  p.tempC = TEMP_DISCONNECTED_C;
+
+  if (dev >= 0) {
+    tempDevices[dev].claimed = true;
+  } else if (tempRomIsZero(probe.addr) && candidates > 1) {
+    // Which one is meant is a guess; one wrong guess heats the wrong tank
+    Serial.printf("✗ Probe %s%s%s: all-zero ROM but %u unnamed probes on bus %u, set one of:\n",
+                  owner ? owner : "", owner ? "/" : "", role, candidates, probe.bus);
+    tempPrintUnnamed(Serial, probe.bus);
+    faultSetCondition(FAULT_PROBE_MAP, true);
+  } else {
+    Serial.printf("✗ Probe %s%s%s not found on bus %u", owner ? owner : "", owner ? "/" : "", role, probe.bus);
+    if (!tempRomIsZero(probe.addr)) {
+      Serial.print(" (");
+      tempPrintRom(Serial, probe.addr);
+      Serial.print(")");
+    }
+    Serial.println();
+  }
+  return tempProbeCount++;
+}
+
+// After the tanks: board-level roles, then list what nobody claimed
+void tempMapRoles() {
+  for (uint8_t i = 0; i < TEMP_ROLE_COUNT; i++) {
+    tempProbeAdd(TEMP_ROLES[i].probe, nullptr, TEMP_ROLES[i].role);
+  }
+  for (uint8_t i = 0; i < tempDeviceCount; i++) {
+    const TempDevice& d = tempDevices[i];
+    if (d.claimed) continue;
+    Serial.printf("  Unassigned probe on bus %u: ", d.bus);
+    tempPrintRom(Serial, d.addr);
+    Serial.println();
+  }
+  Serial.printf("✓ %u probe(s) mapped on %u bus(es)\n", tempProbeCount, TEMP_BUS_COUNT);
+}
+
+// FAULT_PROBE_MAP detail: what is unmapped, and the ROMs to pick from
+void reportProbeMap() {
+  for (uint8_t i = 0; i < tempProbeCount; i++) {
+    const TempProbe& p = tempProbes[i];
+    if (p.found) continue;
+    Serial.printf("   %s%s%s: no probe mapped on bus %u\n", p.owner ? p.owner : "", p.owner ? "/" : "", p.role, p.bus);
+  }
+  for (uint8_t i = 0; i < tempDeviceCount; i++) {
+    const TempDevice& d = tempDevices[i];
+    if (!tempDeviceUnnamed(d)) continue;
+    Serial.printf("   Unnamed on bus %u: ", d.bus);
+    tempPrintRom(Serial, d.addr);
+    Serial.println();
+  }
+}
+
+// ═══════════════════════════════════════════════════════════════
+// ACQUISITION
+// ═══════════════════════════════════════════════════════════════
+
+bool tempBusHasProbes(uint8_t bus) {
+  for (uint8_t i = 0; i < tempProbeCount; i++) {
+    if (tempProbes[i].bus == bus) return true;
+  }
+  return false;
+}
+
+// Skip ROM: every device on the bus starts converting at once. On a
+// parasite bus the strong pullup stays on until the next reset.
+void tempStartConversion(uint8_t bus) {
+  OneWire& w = tempBuses[bus];
+  if (w.reset()) {
+    w.skip();
+    w.write(DS18B20_CONVERT_T, tempBusParasite[bus] ? 1 : 0);
+  }
+}
+
+// One probe's scratchpad, by ROM. Rejects bad CRCs, an all-zero pad
+// (CRC of zeros is zero: shorted bus), and the 85 °C power-on value.
+TempRead tempReadScratchpad(uint8_t bus, const uint8_t* addr, float& tempC) {
+  OneWire& w = tempBuses[bus];
+  uint8_t sp[9];
+  if (!w.reset()) return TEMP_READ_NO_PRESENCE;
+  w.select(addr);
+  w.write(DS18B20_READ_SCRATCHPAD);
+  for (uint8_t i = 0; i < 9; i++) sp[i] = w.read();
+
+  if (OneWire::crc8(sp, 8) != sp[8]) return TEMP_READ_BAD_PAD;
+  if ((sp[4] & 0x9F) != 0x1F) return TEMP_READ_BAD_PAD;    // config register has fixed bits
+  int16_t raw = (int16_t)((sp[1] << 8) | sp[0]);
+  if (raw == DS18B20_POWER_ON_RAW) return TEMP_READ_POWER_ON;
+  tempC = raw / 16.0;
+  return TEMP_READ_OK;
+}
+
+// A failed read keeps the last value; TEMP_BAD_READS_MAX in a row
+// report the probe disconnected (the tank raises its sensor fault)
+void tempReadProbe(uint8_t i) {
+  TempProbe& p = tempProbes[i];
+  float c;
+  TempRead r = p.found ? tempReadScratchpad(p.bus, p.addr, c) : TEMP_READ_NO_PRESENCE;
+  if (r == TEMP_READ_OK) {
+    p.badReads = 0;
+  } else {
+    if (p.found && r == TEMP_READ_NO_PRESENCE) p.presenceErrors++;
+    if (r == TEMP_READ_BAD_PAD) p.crcErrors++;
+    if (p.badReads < TEMP_BAD_READS_MAX) p.badReads++;
+    c = (p.badReads >= TEMP_BAD_READS_MAX) ? TEMP_DISCONNECTED_C : p.tempC;
+  }
+  p.tempC = ctlTempC(i, c);
+  p.seen = true;
+}
+
+// Once per tick, before the tanks read their temperatures
+void tempService() {
+  unsigned long now = ctlMillis();
+  for (uint8_t b = 0; b < TEMP_BUS_COUNT; b++) {
+    if (!tempBusHasProbes(b)) continue;
+    if (tempBusConverting[b]) {
+      if (now - tempBusStarted[b] < TEMP_CONVERSION_MS) continue;
+      for (uint8_t i = 0; i < tempProbeCount; i++) {
+        if (tempProbes[i].bus == b) tempReadProbe(i);
+      }
+    }
+    tempStartConversion(b);
+    tempBusStarted[b] = now;
+    tempBusConverting[b] = true;
+  }
+}
+
+// Last readings and where each bus is in its conversion
+void tempKeyframe(TraceKeyframe& k) {
+  for (uint8_t i = 0; i < tempProbeCount; i++) {
+    TempProbe& p = tempProbes[i];
+    k.field(p.seen);
+    k.field(p.badReads);
+    k.field(p.tempC);
+  }
+  for (uint8_t b = 0; b < TEMP_BUS_COUNT; b++) {
+    k.field(tempBusConverting[b]);
+    k.ms(tempBusStarted[b]);
+  }
+}
+
+// Unmapped (missing or refused at boot), or TEMP_BAD_READS_MAX failed
+// reads in a row: its reading is TEMP_DISCONNECTED_C, not a temperature
+bool tempProbeFailed(uint8_t probe) {
+  if (probe == TEMP_PROBE_NONE) return true;
+  const TempProbe& p = tempProbes[probe];
+  return !p.found || p.badReads >= TEMP_BAD_READS_MAX;
+}
+
+// A reading to act on: mapped, landed (the first round takes
+// TEMP_CONVERSION_MS) and not failed since
+bool tempProbeReady(uint8_t probe) {
+  return !tempProbeFailed(probe) && tempProbes[probe].seen;
+}
+
+float tempProbeF(uint8_t probe) {
+  return (tempProbes[probe].tempC * 9.0 / 5.0) + 32.0;
+}
+
+// One machine-readable line per probe (console telemetry)
+void printTempProbes(Print& out) {
+  for (uint8_t i = 0; i < tempProbeCount; i++) {
+    const TempProbe& p = tempProbes[i];
+    out.printf("PROBE %s role=%s bus=%u rom=", p.owner ? p.owner : "board", p.role, p.bus);
+    tempPrintRom(out, p.addr);
+    out.printf(" found=%d tempF=%.2f bad=%u crcErrors=%u presenceErrors=%u parasite=%d\n", p.found, tempProbeF(i),
+               p.badReads, p.crcErrors, p.presenceErrors, tempBusParasite[p.bus]);
+  }
+}
+
+// ═══════════════════════════════════════════════════════════════
+// TEMPERATURE FUNCTIONS
+// ═══════════════════════════════════════════════════════════════
+
+// Readings come from the probe network above. tempValid only while the
+// control probe is ready; an unmapped or failed one is a sensor fault.
+void TankController::readTemperatures() {
+  tempValid = tempProbeReady(probeControl);
+  if (tempValid) tempControl = tempProbeF(probeControl);
+  if (hasReference()) tempReference = tempProbeF(probeReference);
+
+  setCondition(FAULT_SENSOR_SUMP, tempProbeFailed(probeControl) ||
+               (tempValid && (tempControl < -100 || tempControl > 150)));
+  setCondition(FAULT_SENSOR_DISPLAY, hasReference() && (tempReference < -100 || tempReference > 150));
+}
+
+// Alert throttling lives in the fault table (hold-off)
+void TankController::checkTemperatureDifferential() {
+  float diff = (tempValid && hasReference()) ? abs(tempControl - tempReference) : 0;
+  setCondition(FAULT_TEMP_DIFFERENTIAL, diff > TEMP_DIFFERENTIAL_ALERT);
+}
+
+void reportTempDifferential() {
+  for (uint8_t i = 0; i < tankCount; i++) {
+    const TankController& t = tanks[i];
+    if (!(t.faults.raw & FAULT_BIT(FAULT_TEMP_DIFFERENTIAL))) continue;
+    Serial.printf("   %s  ", t.cfg->name);
+    Serial.print("Control: ");
+    Serial.print(t.tempControl, 1);
+    Serial.print("°F  Reference: ");
+    Serial.print(t.tempReference, 1);
+    Serial.print("°F  Diff: ");
+    Serial.print(abs(t.tempControl - t.tempReference), 1);
+    Serial.println("°F");
+  }
+}
+
+bool TankController::overTempFaultActive() const {
+  return (tempControl >= TEMP_EMERGENCY_HIGH) || (hasReference() && tempReference >= TEMP_EMERGENCY_HIGH);
+}
+
+// E-stop entry is driven by the fault table (FAULT_OVER_TEMP triggers it)
+void TankController::checkEmergencyShutoff() {
+  setCondition(FAULT_OVER_TEMP, overTempFaultActive());
+}
+
+void reportOverTemp() {
+  Serial.println("   EMERGENCY - Temperature too high!");
+  for (uint8_t i = 0; i < tankCount; i++) {
+    const TankController& t = tanks[i];
+    if (!(t.faults.raw & FAULT_BIT(FAULT_OVER_TEMP))) continue;
+    Serial.printf("   %s  ", t.cfg->name);
+    Serial.print("Control: ");
+    Serial.print(t.tempControl, 1);
+    if (t.hasReference()) {
+      Serial.print("°F  Reference: ");
+      Serial.print(t.tempReference, 1);
+    }
+    Serial.println("°F");
+  }
+}
+
+void TankController::controlHeaters() {
+  uint8_t primary = cfg->relays.heaterPrimary;
+  uint8_t backup = cfg->relays.heaterBackup;
+
+  // Stopped, or no control reading to trust: both heaters off
+  if (stopped() || !tempValid) {
+    if (heaterPrimaryOn) {
+      setOutput(primary, false);
+      heaterPrimaryOn = false;
+      if (!tempValid) Serial.printf("✗ %s: primary heater OFF (no control probe reading)\n", cfg->name);
+    }
+    if (heaterBackupOn) {
+      setOutput(backup, false);
+      heaterBackupOn = false;
+    }
+    return;
+  }
+
+  float controlTemp = tempControl;
+
+  if (controlTemp < (targetTemp - hysteresis)) {
+    if (!heaterPrimaryOn) {
+      setOutput(primary, true);
+      heaterPrimaryOn = true;
+      Serial.printf("✓ %s: primary heater ON (", cfg->name);
+      Serial.print(controlTemp, 1);
+      Serial.println("°F)");
+    }
+  } else if (controlTemp > (targetTemp + hysteresis)) {
+    if (heaterPrimaryOn) {
+      setOutput(primary, false);
+      heaterPrimaryOn = false;
+      Serial.printf("✓ %s: primary heater OFF (", cfg->name);
+      Serial.print(controlTemp, 1);
+      Serial.println("°F)");
+    }
+  }
+
+  if (heaterBackupOn) {
+    setOutput(backup, false);
+    heaterBackupOn = false;
+  }
+}
+
+#endif
@@ -0,0 +1,542 @@
+// ═══════════════════════════════════════════════════════════════
+// BUS / BLOCKING BUDGET BENCHMARK (host)
+// ═══════════════════════════════════════════════════════════════
+// Runs scripted scenarios through the unmodified sketch and counts
+// what it would have done to the hardware: I2C transactions (split by
+// relay box, buttons, LEDs, RTC), IR frames, OneWire conversions and
+// bus time, Serial bytes, time spent blocked in delay() and heater
+// on-time. Each scenario runs
+// in its own process so module statics start clean.
+//
+// Build (from the repo root):
+//   g++ -std=gnu++17 -O2 -I tools/host/shim tools/host/bench.cpp -o bench
+//
+// Usage:
+//   ./bench                      compare against tools/host/bench_baseline.txt
+//   ./bench --update --why KEY=TEXT ...
+//                                rewrite the baseline from this run
+//   ./bench --known KEY=TEXT     (with --update) baseline a value as a
+//                                known failure instead of a target
+//   ./bench --check-baseline REV every changed row vs. git REV carries
+//                                a new justification (run before commit)
+//   ./bench --report out.txt     also write this run's report
+//   ./bench boot feed            run only the named scenarios
+//
+// KEY is scenario/metric, */metric or scenario/*.
+//
+// Baseline format, one metric per line:
+//   <scenario> <metric> <value>  [# <why>]
+// A row whose value changed must say why, on that row, in the same
+// commit; --update refuses to write one without a --why. Rows noted
+// "known: ..." record behaviour that is wrong today; they are reported
+// as KNOWN, and fixing them shows up as an improvement.
+// Exits 1 if any metric regressed past its budget or a baseline change
+// is unjustified.
+
+#include "shim/Arduino.h"
+#include "../../aquarium_controller.ino"
+#include "harness.h"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// ═══════════════════════════════════════════════════════════════
+// METRICS
+// ═══════════════════════════════════════════════════════════════
+
+enum BenchMetric : uint8_t {
+  M_PASSES,
+  M_I2C_TOTAL,
+  M_I2C_RELAY,       // setRelay
+  M_I2C_BUTTONS,     // DebouncedButton
+  M_I2C_LEDS,        // updateLEDs
+  M_I2C_RTC,
+  M_IR_FRAMES,       // irTransmit, retries included
+  M_ONEWIRE_CONV,    // tempService: CONVERT T commands sent
+  M_ONEWIRE_BUS_MS,  // resets, ROM selects and scratchpad reads
+  M_SERIAL_BYTES,
+  M_DELAY_MS,
+  M_DELAY_CALLS,
+  M_MAX_BLOCK_MS,
+  M_HEATER_ON_S,     // display tank heater relays
+  METRIC_COUNT
+};
+
+// Allowed growth before a metric counts as a regression. Blocking
+// metrics get no slack: any new delay() path should be a conscious
+// baseline update.
+struct MetricDef {
+  const char* name;
+  uint8_t slackPct;
+};
+
+const MetricDef METRICS[METRIC_COUNT] = {
+  { "passes",         10 },
+  { "i2c_total",      10 },
+  { "i2c_relay",      10 },
+  { "i2c_buttons",    10 },
+  { "i2c_leds",       10 },
+  { "i2c_rtc",        10 },
+  { "ir_frames",      10 },
+  { "onewire_conv",   10 },
+  { "onewire_bus_ms", 10 },
+  { "serial_bytes",   25 },
+  { "delay_ms",        0 },
+  { "delay_calls",     0 },
+  { "max_block_ms",    0 },
+  { "heater_on_s",     10 },
+};
+
+struct BenchResult {
+  uint32_t v[METRIC_COUNT];
+};
+
+BenchResult benchCollect() {
+  BenchResult r = {};
+  r.v[M_PASSES]         = hostRunStats.passes;
+  r.v[M_I2C_TOTAL]      = hostCounters.i2cTransactions;
+  r.v[M_I2C_RELAY]      = relayBox.writes;
+  r.v[M_I2C_BUTTONS]    = buttonBox.reads;
+  r.v[M_I2C_LEDS]       = buttonBox.writes;
+  r.v[M_I2C_RTC]        = rtc.reads;
+  r.v[M_IR_FRAMES]      = hostCounters.irFrames;
+  r.v[M_ONEWIRE_CONV]   = hostCounters.oneWireConversions;
+  r.v[M_ONEWIRE_BUS_MS] = hostCounters.oneWireBusUs / 1000;
+  r.v[M_SERIAL_BYTES]   = hostCounters.serialBytes;
+  r.v[M_DELAY_MS]       = hostCounters.delayMs;
+  r.v[M_DELAY_CALLS]    = hostCounters.delayCalls;
+  r.v[M_MAX_BLOCK_MS]   = hostRunStats.maxBlockMs;
+  r.v[M_HEATER_ON_S]    = hostRunStats.heaterOnMs / 1000;
+  return r;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// SCENARIOS
+// ═══════════════════════════════════════════════════════════════
+
+const unsigned long MIN = 60000UL;
+
+// Cold boot into daylight, setup() only
+void scenarioBoot() {
+  hostStart(14, 0);
+  hostResetCounters();
+  uint32_t before = hostCounters.delayMs;
+  setup();
+  hostRunStats.maxBlockMs = hostCounters.delayMs - before;
+}
+
+// Full daylight for an hour: clouds, heater cycling, status prints
+void scenarioDaylightHour() {
+  hostStart(12, 0);
+  setup();
+  hostResetCounters();
+  hostRun(60 * MIN, nullptr);
+}
+
+// Same hour with a fifth of the IR echoes lost: absolute frames are
+// retried, relative steps resynced after the cloud
+void scenarioIrLoss() {
+  hostStart(12, 0);
+  hostIrLossPct = 20;
+  setup();
+  hostResetCounters();
+  hostRun(60 * MIN, nullptr);
+}
+
+// 09:25 boot, through the 09:30-10:00 ramp and a few minutes past it
+void scenarioSunrise() {
+  hostStart(9, 25);
+  setup();
+  hostResetCounters();
+  hostRun(40 * MIN, nullptr);
+}
+
+// A probe the boot search found, listed once the tanks have mapped
+// theirs. On the board its ROM would be in TANK_CONFIGS / TEMP_ROLES,
+// which keeps it away from an all-zero ROM; the bench cannot edit
+// those, so it shows up only after setup().
+void benchAttachProbe(uint8_t bus, const uint8_t* rom) {
+  OneWire& w = tempBuses[bus];
+  w.attach(rom, hostWaterC);
+  TempDevice& d = tempDevices[tempDeviceCount++];
+  d.bus = bus;
+  memcpy(d.addr, w.devices[w.deviceCount - 1].rom, 8);
+  d.claimed = false;
+}
+
+// Second tank on the same board: one probe by ROM on the sump bus,
+// heater on the spare relay, its own fixture. Conversions, I2C and
+// blocking should match daylight_hour; the extra probe adds only its
+// scratchpad reads to the bus time, and IR and Serial grow.
+const TankConfig BENCH_QT_TANK = {
+  "QT", 79.0, 0.5,
+  { TEMP_BUS_SUMP, { 0x28, 0xFF, 0x4B, 0x1A, 0x62, 0x16, 0x03, 0xBC } },
+  { TEMP_BUS_NONE, {0} },
+  { RELAY_SPARE, RELAY_NONE, RELAY_NONE, RELAY_NONE, RELAY_NONE },
+  { PIN_NONE, PIN_NONE, PIN_NONE },
+  true, 0x7F00, true,
+  { clockMinutes(8, 0), clockMinutes(8, 30), clockMinutes(18, 0), clockMinutes(18, 30) }
+};
+
+void scenarioTwoTanks() {
+  hostStart(12, 0);
+  setup();
+  benchAttachProbe(TEMP_BUS_SUMP, BENCH_QT_TANK.control.addr);
+  tankAdd(BENCH_QT_TANK)->start();
+  hostResetCounters();
+  hostRun(60 * MIN, nullptr);
+}
+
+// Daylight hour with four more probes on the display bus, read as
+// board roles. Conversions stay at daylight_hour's count; bus time
+// grows by one scratchpad read per probe per round.
+void scenarioProbes() {
+  hostStart(12, 0);
+  setup();
+  for (uint8_t i = 0; i < 4; i++) {
+    uint8_t rom[8] = { DS18B20_FAMILY, 0xB0, i, 0, 0, 0, 0x02, 0 };
+    benchAttachProbe(TEMP_BUS_DISPLAY, rom);
+  }
+  for (uint8_t i = 0; i < tempDeviceCount; i++) {
+    if (tempDevices[i].claimed) continue;
+    TankProbe p = { tempDevices[i].bus, {0} };
+    memcpy(p.addr, tempDevices[i].addr, 8);
+    tempProbeAdd(p, nullptr, "bench");
+  }
+  hostResetCounters();
+  hostRun(60 * MIN, nullptr);
+}
+
+// Daylight hour with a second unnamed probe on the sump bus: the
+// control probe's all-zero ROM is refused, so the heaters must stay
+// off for the whole hour (heater_on_s 0) instead of heating on -127 °C
+void scenarioUnmappedProbe() {
+  hostStart(12, 0);
+  uint8_t rom[8] = { DS18B20_FAMILY, 0xB1, 0, 0, 0, 0, 0x02, 0 };
+  tempBuses[TEMP_BUS_SUMP].attach(rom, hostWaterC);
+  setup();
+  hostResetCounters();
+  hostRun(60 * MIN, nullptr);
+}
+
+// Presses are held longer than the worst blocking pass so a scripted
+// press is never swallowed whole. That pass (soundAlarm on E-stop
+// entry) is baselined as a known failure: shorter presses can be lost.
+const unsigned long PRESS_MS = 2000;
+
+// E-stop press, then blue held to arm with red pressed once armed (override)
+void estopInputs(unsigned long ms) {
+  bool red = hostWithin(ms, 60000, PRESS_MS) || hostWithin(ms, 126000, PRESS_MS);
+  hostPinLevel[ESTOP_BUTTON_PIN] = red ? LOW : HIGH;
+  hostSetButton(BTN_BLUE, hostWithin(ms, 120000, 9000));
+}
+
+void scenarioEstop() {
+  hostStart(12, 0);
+  setup();
+  hostResetCounters();
+  hostRun(5 * MIN, estopInputs);
+}
+
+// Yellow press, then run past FEED_MODE_DURATION so it times out
+void feedInputs(unsigned long ms) {
+  hostSetButton(BTN_YELLOW, hostWithin(ms, 30000, PRESS_MS));
+}
+
+void scenarioFeed() {
+  hostStart(12, 0);
+  setup();
+  hostResetCounters();
+  hostRun(30000 + FEED_MODE_DURATION + MIN, feedInputs);
+}
+
+// A bench-test script driving the console: settings, a mode, dumps
+void consoleInputs(unsigned long ms) {
+  if (ms == 30000) {
+    hostConsole("get target\nset target 77.5\nset feed 2\nmode feed\n"
+                "telemetry\nhist ato\nhist wakes\nsnapshot\nstatus\n");
+  }
+}
+
+void scenarioConsole() {
+  hostStart(12, 0);
+  setup();
+  hostResetCounters();
+  hostRun(5 * MIN, consoleInputs);
+}
+
+struct BenchScenario {
+  const char* name;
+  void (*run)();
+};
+
+const BenchScenario SCENARIOS[] = {
+  { "boot",          scenarioBoot },
+  { "daylight_hour", scenarioDaylightHour },
+  { "ir_loss",       scenarioIrLoss },
+  { "two_tanks",     scenarioTwoTanks },
+  { "probes",        scenarioProbes },
+  { "unmapped_probe", scenarioUnmappedProbe },
+  { "sunrise",       scenarioSunrise },
+  { "estop",         scenarioEstop },
+  { "feed",          scenarioFeed },
+  { "console",       scenarioConsole },
+};
+
+// Forks so every scenario starts from fresh globals
+bool benchRunIsolated(const BenchScenario& s, BenchResult& out) {
+  int fds[2];
+  if (pipe(fds) != 0) return false;
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    s.run();
+    BenchResult r = benchCollect();
+    ssize_t n = write(fds[1], &r, sizeof(r));
+    _exit(n == (ssize_t)sizeof(r) ? 0 : 1);
+  }
+  close(fds[1]);
+  ssize_t n = read(fds[0], &out, sizeof(out));
+  close(fds[0]);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return n == (ssize_t)sizeof(out) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// REPORT / BASELINE
+// ═══════════════════════════════════════════════════════════════
+
+struct BenchRow {
+  uint32_t value;
+  std::string note;      // why the value is what it is; "known: ..." = known failure
+};
+
+typedef std::map<std::string, std::map<std::string, BenchRow>> BenchTable;
+
+const char* const BENCH_KNOWN_PREFIX = "known: ";
+
+bool benchKnown(const BenchRow& row) {
+  return row.note.compare(0, strlen(BENCH_KNOWN_PREFIX), BENCH_KNOWN_PREFIX) == 0;
+}
+
+void benchWrite(std::ostream& out, const BenchTable& table) {
+  out << "# scenario metric value  [# why; \"known: ...\" = known failure]\n";
+  for (const auto& s : table) {
+    for (uint8_t m = 0; m < METRIC_COUNT; m++) {
+      auto it = s.second.find(METRICS[m].name);
+      if (it == s.second.end()) continue;
+      out << s.first << " " << it->first << " " << it->second.value;
+      if (!it->second.note.empty()) out << "  # " << it->second.note;
+      out << "\n";
+    }
+  }
+}
+
+bool benchParse(std::istream& in, BenchTable& table) {
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line.empty() || line[0] == '#') continue;
+    char s[64], m[64];
+    uint32_t value;
+    if (sscanf(line.c_str(), "%63s %63s %u", s, m, &value) != 3) continue;
+    BenchRow& row = table[s][m];
+    row.value = value;
+    size_t hash = line.find('#');
+    if (hash != std::string::npos) {
+      size_t start = line.find_first_not_of(' ', hash + 1);
+      if (start != std::string::npos) row.note = line.substr(start);
+    }
+  }
+  return true;
+}
+
+bool benchLoad(const char* path, BenchTable& table) {
+  std::ifstream in(path);
+  if (!in) return false;
+  return benchParse(in, table);
+}
+
+// Baseline as committed at a git revision
+bool benchLoadRevision(const char* rev, const char* path, BenchTable& table) {
+  std::string cmd = std::string("git show '") + rev + ":" + path + "' 2>/dev/null";
+  FILE* p = popen(cmd.c_str(), "r");
+  if (!p) return false;
+  std::string text;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), p)) > 0) text.append(buf, n);
+  if (pclose(p) != 0) return false;
+  std::istringstream in(text);
+  return benchParse(in, table);
+}
+
+// KEY=TEXT arguments, looked up as scenario/metric, */metric, scenario/*
+typedef std::map<std::string, std::string> BenchNotes;
+
+bool benchAddNote(BenchNotes& notes, const char* arg) {
+  const char* eq = strchr(arg, '=');
+  if (!eq || eq == arg || !eq[1]) return false;
+  notes[std::string(arg, eq - arg)] = eq + 1;
+  return true;
+}
+
+const std::string* benchFindNote(const BenchNotes& notes, const std::string& scenario, const std::string& metric) {
+  for (const std::string& key : { scenario + "/" + metric, "*/" + metric, scenario + "/*" }) {
+    auto it = notes.find(key);
+    if (it != notes.end()) return &it->second;
+  }
+  return nullptr;
+}
+
+// Every row that is new or changed vs `before` needs a note it did not have
+int benchCheckJustified(const BenchTable& before, const BenchTable& after) {
+  int missing = 0;
+  for (const auto& s : after) {
+    for (const auto& m : s.second) {
+      const BenchRow* old = nullptr;
+      auto bs = before.find(s.first);
+      if (bs != before.end() && bs->second.count(m.first)) old = &bs->second.at(m.first);
+      if (old && old->value == m.second.value) continue;
+      if (!m.second.note.empty() && (!old || old->note != m.second.note)) continue;
+      printf("%-14s %-14s %10s -> %u  no justification\n", s.first.c_str(), m.first.c_str(),
+             old ? std::to_string(old->value).c_str() : "-", m.second.value);
+      missing++;
+    }
+  }
+  return missing;
+}
+
+int main(int argc, char** argv) {
+  const char* baselinePath = "tools/host/bench_baseline.txt";
+  const char* reportPath = nullptr;
+  const char* checkRev = nullptr;
+  bool update = false;
+  BenchNotes why, known;
+  std::vector<std::string> only;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--update") == 0) update = true;
+    else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baselinePath = argv[++i];
+    else if (strcmp(argv[i], "--report") == 0 && i + 1 < argc) reportPath = argv[++i];
+    else if (strcmp(argv[i], "--check-baseline") == 0 && i + 1 < argc) checkRev = argv[++i];
+    else if ((strcmp(argv[i], "--why") == 0 || strcmp(argv[i], "--known") == 0) && i + 1 < argc) {
+      BenchNotes& notes = (argv[i][2] == 'w') ? why : known;
+      if (!benchAddNote(notes, argv[++i])) {
+        fprintf(stderr, "%s: expected KEY=TEXT, got '%s'\n", argv[i - 1], argv[i]);
+        return 2;
+      }
+    }
+    else only.push_back(argv[i]);
+  }
+
+  BenchTable baseline;
+  bool haveBaseline = benchLoad(baselinePath, baseline);
+
+  // Commit gate: no scenarios run, just the file against git
+  if (checkRev) {
+    BenchTable committed;
+    if (!benchLoadRevision(checkRev, baselinePath, committed)) {
+      fprintf(stderr, "no baseline at %s:%s\n", checkRev, baselinePath);
+      return 2;
+    }
+    int missing = benchCheckJustified(committed, baseline);
+    if (missing) {
+      printf("\n%d baseline change(s) vs %s without a justification\n", missing, checkRev);
+      return 1;
+    }
+    printf("baseline changes vs %s are justified\n", checkRev);
+    return 0;
+  }
+
+  BenchTable results;
+  for (const BenchScenario& s : SCENARIOS) {
+    if (!only.empty() && std::find(only.begin(), only.end(), s.name) == only.end()) continue;
+    BenchResult r;
+    if (!benchRunIsolated(s, r)) {
+      fprintf(stderr, "%s: scenario crashed\n", s.name);
+      return 2;
+    }
+    for (uint8_t m = 0; m < METRIC_COUNT; m++) results[s.name][METRICS[m].name].value = r.v[m];
+  }
+
+  if (reportPath) {
+    std::ofstream out(reportPath);
+    benchWrite(out, results);
+  }
+
+  if (update) {
+    // Keep baseline rows for scenarios not run this time; a changed or
+    // new value takes its note from --known / --why, an unchanged one
+    // keeps the note it has
+    BenchTable next = baseline;
+    for (const auto& s : results) {
+      for (const auto& m : s.second) {
+        BenchRow& row = next[s.first][m.first];
+        bool changed = !baseline.count(s.first) || !baseline.at(s.first).count(m.first) || row.value != m.second.value;
+        const std::string* k = benchFindNote(known, s.first, m.first);
+        const std::string* w = benchFindNote(why, s.first, m.first);
+        row.value = m.second.value;
+        if (k) row.note = BENCH_KNOWN_PREFIX + *k;
+        else if (w && changed) row.note = *w;
+      }
+    }
+    int missing = benchCheckJustified(baseline, next);
+    if (missing) {
+      printf("\n%d changed metric(s) need --why (or --known); baseline not written\n", missing);
+      return 1;
+    }
+    std::ofstream out(baselinePath);
+    benchWrite(out, next);
+    printf("baseline written to %s\n", baselinePath);
+    return 0;
+  }
+
+  if (!haveBaseline) {
+    fprintf(stderr, "no baseline at %s (run with --update)\n", baselinePath);
+  }
+
+  int regressions = 0;
+  int knownFailures = 0;
+  printf("%-14s %-14s %10s %10s\n", "scenario", "metric", "baseline", "now");
+  for (const auto& s : results) {
+    for (uint8_t m = 0; m < METRIC_COUNT; m++) {
+      const MetricDef& def = METRICS[m];
+      uint32_t now = s.second.at(def.name).value;
+      const char* verdict = "";
+      long base = -1;
+      auto bs = baseline.find(s.first);
+      if (bs != baseline.end() && bs->second.count(def.name)) {
+        const BenchRow& row = bs->second.at(def.name);
+        base = row.value;
+        uint64_t budget = (uint64_t)base + (uint64_t)base * def.slackPct / 100;
+        if (now > budget) {
+          verdict = "  REGRESSED";
+          regressions++;
+        } else if ((long)now < base) {
+          verdict = benchKnown(row) ? "  improved (was known failure)" : "  improved";
+        } else if (benchKnown(row)) {
+          verdict = "  KNOWN";
+          knownFailures++;
+        }
+      }
+      if (base < 0) printf("%-14s %-14s %10s %10u  new\n", s.first.c_str(), def.name, "-", now);
+      else printf("%-14s %-14s %10ld %10u%s\n", s.first.c_str(), def.name, base, now, verdict);
+    }
+  }
+
+  if (knownFailures) printf("\n%d known failure(s) baselined (see # known: in %s)\n", knownFailures, baselinePath);
+  if (regressions) {
+    printf("\n%d metric(s) over budget\n", regressions);
+    return 1;
+  }
+  printf("\nwithin budget\n");
+  return 0;
+}
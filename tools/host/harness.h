@@ -0,0 +1,145 @@
+#ifndef HOST_HARNESS_H
+#define HOST_HARNESS_H
+
+// ═══════════════════════════════════════════════════════════════
+// HOST HARNESS: drive the sketch through scripted time
+// ═══════════════════════════════════════════════════════════════
+// Include after the sketch. Time advances in HOST_STEP_MS steps; the
+// scenario's input function sets pins/buttons/temperatures for each
+// step. loop() runs only when the firmware would actually wake: its
+// requested idle deadline passed, or an input edge fired one of the
+// interrupts idle.h arms. delay() moves virtual time forward, so
+// blocking delays later passes the way it would on the board.
+
+const unsigned long HOST_STEP_MS = 10;
+
+typedef void (*HostInputFn)(unsigned long ms);
+
+struct HostRunStats {
+  uint32_t passes;
+  uint32_t maxBlockMs;   // longest delay() total inside a single pass
+  uint32_t heaterOnMs;   // either heater relay on
+};
+
+inline HostRunStats hostRunStats = {};
+
+// Simple tank: heater adds ~1.0 °C/h, losses take ~0.6 °C/h
+inline double hostWaterC = 25.5;
+inline bool hostThermalModel = true;
+inline unsigned long hostThermalMs = 0;
+
+// IR loopback: our receiver sees every sent frame except hostIrLossPct %
+inline uint8_t hostIrLossPct = 0;
+inline uint32_t hostIrLossSeed = 1;
+
+inline void hostIrPulse(uint16_t markUs, uint16_t spaceUs) {
+  irEdgePush(markUs, true);
+  if (spaceUs) irEdgePush(spaceUs, false);
+}
+
+// NEC timing, as the edge ISR would timestamp it
+inline void hostIrEcho(uint16_t address, uint8_t command, int repeats) {
+  hostIrLossSeed = hostIrLossSeed * 1103515245 + 12345;
+  if ((hostIrLossSeed >> 16) % 100 < hostIrLossPct) return;
+
+  // 8-bit addresses go out with their inverse, wider ones as-is (extended NEC)
+  uint16_t addr = address > 0xFF ? address : (address | ((uint8_t)~address << 8));
+  uint32_t data = addr | ((uint32_t)command << 16) | ((uint32_t)(uint8_t)~command << 24);
+  irEdgePush(40000, false);            // idle before the leader
+  hostIrPulse(9000, 4500);
+  for (uint8_t i = 0; i < 32; i++) hostIrPulse(560, (data >> i) & 1 ? 1690 : 560);
+  hostIrPulse(560, 40000);
+  for (int r = 0; r < repeats; r++) {
+    hostIrPulse(9000, 2250);
+    hostIrPulse(560, 40000);
+  }
+}
+
+// Cold start at the given wall-clock time with all inputs idle
+inline void hostStart(uint8_t hour, uint8_t minute) {
+  rtc.startUnix = 1760000000 - (1760000000 % 86400) + hour * 3600UL + minute * 60UL;
+  hostNowMs = 0;
+  hostThermalMs = 0;
+  srand(1);
+  hostPinLevel[ESTOP_BUTTON_PIN] = HIGH;
+  hostPinLevel[ATO_FLOAT_LOW] = HIGH;
+  hostPinLevel[ATO_FLOAT_HIGH] = HIGH;
+  hostPinLevel[ATO_RESERVOIR_EMPTY] = HIGH;
+  buttonBox.inputs = 0xFF;
+  for (uint8_t b = 0; b < TEMP_BUS_COUNT; b++) {
+    tempBuses[b] = OneWire(tempBuses[b].pin);     // back to one probe per bus
+    tempBuses[b].setTempC(hostWaterC);
+  }
+  Serial.input = nullptr;
+  hostIrLossSeed = 1;
+  hostIrLoopback = CFG_IR_VERIFY ? hostIrEcho : nullptr;
+}
+
+// Zero everything measured so far (e.g. after setup())
+inline void hostResetCounters() {
+  hostCounters = {};
+  hostRunStats = {};
+  buttonBox.reads = buttonBox.writes = 0;
+  relayBox.reads = relayBox.writes = 0;
+  rtc.reads = 0;
+}
+
+inline void hostThermalStep() {
+  bool heating = !(relayStates & (1 << RELAY_HEATER_PRIMARY)) ||
+                 !(relayStates & (1 << RELAY_HEATER_BACKUP));
+  hostWaterC += (heating ? 1.0 : -0.6) * (hostNowMs - hostThermalMs) / 3600000.0;
+  hostThermalMs = hostNowMs;
+  float probe = round(hostWaterC * 16) / 16;    // DS18B20 resolution
+  for (uint8_t b = 0; b < TEMP_BUS_COUNT; b++) tempBuses[b].setTempC(probe);
+}
+
+// Runs until virtual time reaches untilMs
+inline void hostRun(unsigned long untilMs, HostInputFn inputs) {
+  uint8_t lastFloats = 0xFF;
+  uint8_t lastButtons = buttonBox.inputs;
+  uint8_t lastEstop = hostPinLevel[ESTOP_BUTTON_PIN];
+
+  for (; hostNowMs < untilMs; hostNowMs += HOST_STEP_MS) {
+    if (inputs) inputs(hostNowMs);
+    if (hostThermalModel) hostThermalStep();
+    if (!(relayStates & (1 << RELAY_HEATER_PRIMARY)) || !(relayStates & (1 << RELAY_HEATER_BACKUP))) {
+      hostRunStats.heaterOnMs += HOST_STEP_MS;
+    }
+
+    uint8_t floats = hostPinLevel[ATO_FLOAT_LOW] |
+                     (hostPinLevel[ATO_FLOAT_HIGH] << 1) |
+                     (hostPinLevel[ATO_RESERVOIR_EMPTY] << 2);
+    uint8_t wakes = 0;
+    if (lastFloats != 0xFF && floats != lastFloats) wakes |= WAKE_FLOAT;
+    if (CFG_BUTTON_BOX_INT_WIRED && buttonBox.inputs != lastButtons) wakes |= WAKE_BUTTON;
+    if (lastEstop == HIGH && hostPinLevel[ESTOP_BUTTON_PIN] == LOW) wakes |= WAKE_ESTOP;
+    lastFloats = floats;
+    lastButtons = buttonBox.inputs;
+    lastEstop = hostPinLevel[ESTOP_BUTTON_PIN];
+    idlePendingWakes |= wakes;
+
+    if (wakes || (long)(hostNowMs - idleDeadline) >= 0) {
+      uint32_t before = hostCounters.delayMs;
+      loop();
+      hostRunStats.passes++;
+      hostRunStats.maxBlockMs = std::max(hostRunStats.maxBlockMs, hostCounters.delayMs - before);
+    }
+  }
+}
+
+// Input helpers for scenario scripts
+inline bool hostWithin(unsigned long ms, unsigned long start, unsigned long len) {
+  return ms >= start && ms < start + len;
+}
+
+inline void hostSetButton(uint8_t pin, bool pressed) {
+  if (pressed) buttonBox.inputs &= ~(1 << pin);
+  else buttonBox.inputs |= (1 << pin);
+}
+
+// Queues console lines ("cmd\ncmd\n"); the string must outlive the run
+inline void hostConsole(const char* lines) {
+  Serial.input = lines;
+}
+
+#endif
@@ -0,0 +1,148 @@
+// ═══════════════════════════════════════════════════════════════
+// TRACE REPLAY (host)
+// ═══════════════════════════════════════════════════════════════
+// Replays a trace dumped by the controller (`trace` on the console)
+// through the unmodified sketch, compiled for the PC against the
+// shims in tools/host/shim. Virtual time comes from the trace, so an
+// hour of recording replays in milliseconds.
+//
+// Build (from the repo root):
+//   g++ -std=gnu++17 -O2 -I tools/host/shim tools/host/replay.cpp -o replay
+//
+// Usage:
+//   ./replay capture.log [-v]
+//
+// Prints the relay/IR output sequence with timestamps and exits
+// non-zero if it differs from the outputs recorded in the trace.
+
+#include "shim/Arduino.h"
+#include "../../aquarium_controller.ino"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+
+struct ReplayOutput {
+  unsigned long ms;
+  TraceType type;
+  uint8_t value;
+  uint8_t extra;
+  bool matched;
+};
+
+static std::vector<ReplayOutput> replayOutputs;
+
+static void collectOutput(TraceType type, uint8_t value, uint8_t extra, bool matched) {
+  replayOutputs.push_back({ ctlMillis(), type, value, extra, matched });
+}
+
+// Finds the TRACE BEGIN ... TRACE END block in a terminal capture
+static bool loadTrace(const char* path) {
+  std::ifstream in(path);
+  if (!in) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+
+  std::string line;
+  uint32_t expected = 0;
+  int wrapped = 0;
+  unsigned long base = 0;
+  uint32_t sum = 0;
+  bool inside = false;
+  bool ended = false;
+  std::vector<uint8_t> bytes;
+
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (!inside) {
+      if (sscanf(line.c_str(), "TRACE BEGIN %u %d %lu", &expected, &wrapped, &base) >= 2) {
+        inside = true;
+        bytes.clear();
+      }
+      continue;
+    }
+    if (line.rfind("TRACE END", 0) == 0) {
+      ended = sscanf(line.c_str(), "TRACE END %x", &sum) == 1;
+      break;
+    }
+    // Console output can land between the hex lines of a streamed dump
+    if (line.empty() || line.size() % 2 || line.find_first_not_of("0123456789ABCDEFabcdef") != std::string::npos) {
+      continue;
+    }
+    for (size_t i = 0; i + 1 < line.size(); i += 2) {
+      bytes.push_back((uint8_t)strtoul(line.substr(i, 2).c_str(), nullptr, 16));
+    }
+  }
+
+  if (!inside || bytes.size() != expected || bytes.size() > TRACE_BUFFER_SIZE) {
+    fprintf(stderr, "no complete trace in %s (%zu of %u bytes)\n", path, bytes.size(), expected);
+    return false;
+  }
+
+  uint32_t check = 0;
+  for (uint8_t b : bytes) check = check * 31 + b;
+  if (!ended || check != sum) {
+    fprintf(stderr, "checksum mismatch in %s (capture damaged?)\n", path);
+    return false;
+  }
+
+  memcpy(traceBuf, bytes.data(), bytes.size());
+  traceHead = 0;
+  traceLen = bytes.size();
+  traceWrapped = wrapped != 0;
+  traceBaseTime = base;
+  return true;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s capture.log [-v]\n", argv[0]);
+    return 2;
+  }
+  hostSerialEcho = (argc > 2 && strcmp(argv[2], "-v") == 0);
+  if (!loadTrace(argv[1])) return 2;
+
+  traceReplayActive = true;
+  if (traceWrapped) {
+    if (tracePeekType() == TRACE_KEYFRAME) {
+      printf("note: trace wrapped; replay seeded from its first keyframe\n");
+    } else {
+      printf("note: trace wrapped with no keyframe; replay starts cold mid-stream and early outputs may differ\n");
+    }
+  }
+
+  traceOutputSink = collectOutput;
+
+  hostNowMs = traceBaseTime;
+  setup();
+  uint32_t passes = 0;
+  while (!traceAtEnd() || traceNextPassReady()) {
+    if (!traceNextPassReady()) {
+      if (tracePeekType() != TRACE_KEYFRAME) traceDivergences++;   // recorded but never asked for by the replay
+      traceConsume();
+      continue;
+    }
+    uint8_t wakes = traceNextPassWakes();
+    ctlBeginPass(wakes);
+    hostNowMs = ctlMillis();
+    controllerPass(wakes);
+    passes++;
+  }
+
+  uint32_t mismatches = 0;
+  for (const ReplayOutput& o : replayOutputs) {
+    if (!o.matched) mismatches++;
+    if (o.type == TRACE_RELAY) {
+      printf("%10lu  RELAY  0x%02X%s\n", o.ms, o.value, o.matched ? "" : "  <-- differs");
+    } else {
+      printf("%10lu  IR     cmd 0x%02X rep %u%s\n", o.ms, o.value, o.extra, o.matched ? "" : "  <-- differs");
+    }
+  }
+
+  unsigned long span = ctlMillis() - traceBaseTime;
+  printf("\n%u passes, %zu outputs, %lu ms of controller time\n", passes, replayOutputs.size(), span);
+  printf("divergences: %u\n", traceDivergences);
+  return (traceDivergences == 0 && mismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// ═══════════════════════════════════════════════════════════════
+// HOST SHIM: just enough of Arduino-ESP32 to compile the sketch on a PC
+// ═══════════════════════════════════════════════════════════════
+// Time is virtual (hostNowMs), delay() advances it instantly, and hardware
+// calls go to the mock drivers. Counters in hostCounters let tools
+// measure what the firmware would have done on the bus.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <time.h>
+#include <cmath>
+#include <algorithm>
+
+using std::abs;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define FALLING 0x02
+#define RISING 0x01
+#define CHANGE 0x03
+#define HEX 16
+#define DEC 10
+
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+#define F(s) (s)
+
+// Counters shared with the mock drivers
+struct HostCounters {
+  uint32_t i2cTransactions;
+  uint32_t irFrames;
+  uint32_t oneWireConversions;
+  uint32_t oneWireBusUs;       // reset/ROM/scratchpad slots, not conversion waits
+  uint32_t serialBytes;
+  uint32_t delayMs;
+  uint32_t delayCalls;
+};
+
+inline HostCounters hostCounters = {};
+inline unsigned long hostNowMs = 0;
+inline uint8_t hostPinLevel[64];
+inline bool hostSerialEcho = false;
+
+inline unsigned long millis() { return hostNowMs; }
+inline unsigned long micros() { return hostNowMs * 1000; }
+inline void delay(unsigned long ms) {
+  hostNowMs += ms;
+  hostCounters.delayMs += ms;
+  hostCounters.delayCalls++;
+}
+
+inline void pinMode(uint8_t pin, uint8_t mode) {
+  if (mode == INPUT_PULLUP) hostPinLevel[pin] = HIGH;
+}
+inline int digitalRead(uint8_t pin) { return hostPinLevel[pin]; }
+inline void digitalWrite(uint8_t pin, uint8_t val) { hostPinLevel[pin] = val; }
+inline void tone(uint8_t, unsigned int, unsigned long = 0) {}
+inline void noTone(uint8_t) {}
+
+inline long random(long lo, long hi) { return hi > lo ? lo + rand() % (hi - lo) : lo; }
+inline long random(long hi) { return random(0, hi); }
+inline void randomSeed(unsigned long seed) { srand(seed); }
+
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+inline void attachInterrupt(int, void (*)(), int) {}
+inline void detachInterrupt(int) {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// ═══════════════════════════════════════════════════════════════
+// PRINT / SERIAL
+// ═══════════════════════════════════════════════════════════════
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+
+  size_t write(const char* s) {
+    size_t n = 0;
+    while (*s) n += write((uint8_t)*s++);
+    return n;
+  }
+  size_t print(const char* s) { return write(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(float v, int digits = 2) { return print((double)v, digits); }
+  size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+  size_t print(int v, int base = DEC) { return print((long)v, base); }
+  size_t print(unsigned int v, int base = DEC) { return print((unsigned long)v, base); }
+  size_t print(uint8_t v, int base = DEC) { return print((unsigned long)v, base); }
+  size_t print(long v, int base = DEC) {
+    return base == HEX ? printf("%lX", (unsigned long)v) : printf("%ld", v);
+  }
+  size_t print(unsigned long v, int base = DEC) {
+    return base == HEX ? printf("%lX", v) : printf("%lu", v);
+  }
+  template <typename T> size_t println(T v) { return print(v) + println(); }
+  template <typename T> size_t println(T v, int arg) { return print(v, arg) + println(); }
+  size_t println() { return write((uint8_t)'\n'); }
+
+  size_t printf(const char* fmt, ...) {
+    char buf[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    return write(buf) * (n >= 0);
+  }
+};
+
+// Serial input comes from hostSerialInput (tools feed it)
+class HardwareSerial : public Print {
+public:
+  const char* input = nullptr;
+  void begin(unsigned long) {}
+  void flush() {}
+  int available() { return input && *input ? 1 : 0; }
+  int read() { return available() ? (uint8_t)*input++ : -1; }
+  int availableForWrite() { return 128; }
+  size_t write(uint8_t c) override {
+    hostCounters.serialBytes++;
+    if (hostSerialEcho) fputc(c, stdout);
+    return 1;
+  }
+  using Print::write;
+};
+
+inline HardwareSerial Serial;
+
+// ═══════════════════════════════════════════════════════════════
+// ESP-IDF / FREERTOS BITS USED BY THE SKETCH
+// ═══════════════════════════════════════════════════════════════
+
+typedef void* TaskHandle_t;
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdMS_TO_TICKS(ms) (ms)
+#define portYIELD_FROM_ISR() do {} while (0)
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return (TaskHandle_t)1; }
+inline void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t*) {}
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
+
+struct tm;
+inline void configTzTime(const char*, const char*, const char* = nullptr, const char* = nullptr) {}
+inline bool getLocalTime(struct tm*, uint32_t = 5000) { return false; }
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef HOST_ONEWIRE_H
+#define HOST_ONEWIRE_H
+#include "Arduino.h"
+
+// DS18B20s on a simulated bus. Every bus starts with one probe (ROM
+// derived from the pin); tools attach more and set temperatures. Bus
+// time is charged at standard-speed slot timings.
+const uint8_t HOST_ONEWIRE_DEVICES = 8;
+const uint16_t HOST_ONEWIRE_RESET_US = 960;
+const uint16_t HOST_ONEWIRE_BYTE_US = 8 * 70;
+
+struct HostDs18b20 {
+  uint8_t rom[8];
+  float tempC;
+  bool parasite;            // powered from the data line
+  bool powerOn;             // last conversion starved: pad holds 85 °C
+};
+
+class OneWire {
+public:
+  uint8_t pin;
+  HostDs18b20 devices[HOST_ONEWIRE_DEVICES];
+  uint8_t deviceCount = 0;
+  bool corruptNextRead = false;   // flip a scratchpad bit (CRC failure)
+  bool absentNextReset = false;   // no presence pulse on the next reset
+
+  explicit OneWire(uint8_t p) : pin(p) {
+    uint8_t rom[8] = { 0x28, p, 0, 0, 0, 0, 0x01, 0 };
+    attach(rom, 25.0);
+  }
+
+  void attach(const uint8_t* rom, float tempC, bool parasite = false) {
+    if (deviceCount == HOST_ONEWIRE_DEVICES) return;
+    HostDs18b20& d = devices[deviceCount++];
+    memcpy(d.rom, rom, 7);
+    d.rom[7] = crc8(rom, 7);
+    d.tempC = tempC;
+    d.parasite = parasite;
+    d.powerOn = false;
+  }
+
+  void setTempC(float c) {
+    for (uint8_t i = 0; i < deviceCount; i++) devices[i].tempC = c;
+  }
+
+  uint8_t reset() {
+    hostCounters.oneWireBusUs += HOST_ONEWIRE_RESET_US;
+    selected = -1;
+    spPos = 9;
+    powerQuery = false;
+    if (absentNextReset) {
+      absentNextReset = false;
+      return 0;
+    }
+    return deviceCount ? 1 : 0;
+  }
+  void skip() {
+    hostCounters.oneWireBusUs += HOST_ONEWIRE_BYTE_US;
+    selected = -2;
+  }
+  void select(const uint8_t* rom) {
+    hostCounters.oneWireBusUs += 9 * HOST_ONEWIRE_BYTE_US;
+    selected = -1;
+    for (uint8_t i = 0; i < deviceCount; i++) {
+      if (memcmp(devices[i].rom, rom, 8) == 0) selected = i;
+    }
+  }
+  // A parasite device converting without the strong pullup (power 0)
+  // browns out and keeps its 85 °C power-on value
+  void write(uint8_t v, uint8_t power = 0) {
+    hostCounters.oneWireBusUs += HOST_ONEWIRE_BYTE_US;
+    if (v == 0x44 && selected != -1) {
+      hostCounters.oneWireConversions++;
+      for (uint8_t i = 0; i < deviceCount; i++) {
+        if (selected == -2 || selected == i) devices[i].powerOn = devices[i].parasite && !power;
+      }
+    }
+    if (v == 0xB4) powerQuery = true;
+    if (v == 0xBE && selected >= 0) loadScratchpad(devices[selected]);
+  }
+  uint8_t read_bit() {
+    hostCounters.oneWireBusUs += 70;
+    if (!powerQuery) return 1;
+    for (uint8_t i = 0; i < deviceCount; i++) {
+      if ((selected == -2 || selected == i) && devices[i].parasite) return 0;
+    }
+    return 1;
+  }
+  uint8_t read() {
+    hostCounters.oneWireBusUs += HOST_ONEWIRE_BYTE_US;
+    return spPos < 9 ? sp[spPos++] : 0xFF;
+  }
+  void reset_search() { searchNext = 0; }
+  bool search(uint8_t* rom) {
+    if (searchNext >= deviceCount) return false;
+    hostCounters.oneWireBusUs += HOST_ONEWIRE_RESET_US + 64 * 3 * 70;
+    memcpy(rom, devices[searchNext++].rom, 8);
+    return true;
+  }
+
+  static uint8_t crc8(const uint8_t* addr, uint8_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+      uint8_t in = *addr++;
+      for (uint8_t i = 8; i; i--) {
+        uint8_t mix = (crc ^ in) & 0x01;
+        crc >>= 1;
+        if (mix) crc ^= 0x8C;
+        in >>= 1;
+      }
+    }
+    return crc;
+  }
+
+private:
+  int8_t selected = -1;           // -2 = skip ROM (all devices)
+  uint8_t searchNext = 0;
+  uint8_t sp[9];
+  uint8_t spPos = 9;
+  bool powerQuery = false;        // READ POWER SUPPLY sent since the reset
+
+  void loadScratchpad(const HostDs18b20& d) {
+    int16_t raw = d.powerOn ? 0x0550 : (int16_t)lround(d.tempC * 16);
+    uint8_t pad[9] = { (uint8_t)raw, (uint8_t)(raw >> 8), 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10, 0 };
+    pad[8] = crc8(pad, 8);
+    if (corruptNextRead) {
+      pad[0] ^= 0x01;
+      corruptNextRead = false;
+    }
+    memcpy(sp, pad, 9);
+    spPos = 0;
+  }
+};
+#endif
@@ -0,0 +1,41 @@
+#ifndef HOST_PCF8574_H
+#define HOST_PCF8574_H
+#include "Arduino.h"
+
+// Every digitalRead/digitalWrite is one I2C transaction on real hardware.
+// reads/writes are per expander so tools can tell buttons from LEDs.
+class PCF8574 {
+public:
+  uint8_t address;
+  uint8_t inputs = 0xFF;
+  uint8_t outputs = 0xFF;
+  uint32_t reads = 0;
+  uint32_t writes = 0;
+
+  explicit PCF8574(uint8_t addr) : address(addr) {}
+  bool begin() { hostCounters.i2cTransactions++; return true; }
+  void pinMode(uint8_t, uint8_t) {}
+  uint8_t digitalRead(uint8_t pin) {
+    hostCounters.i2cTransactions++;
+    reads++;
+    return (inputs >> pin) & 1;
+  }
+  // One read for all eight pins (the library's struct form)
+  struct DigitalInput { uint8_t p0, p1, p2, p3, p4, p5, p6, p7; };
+  DigitalInput digitalReadAll() {
+    hostCounters.i2cTransactions++;
+    reads++;
+    DigitalInput in;
+    uint8_t* p = &in.p0;
+    for (uint8_t i = 0; i < 8; i++) p[i] = (inputs >> i) & 1;
+    return in;
+  }
+  bool digitalWrite(uint8_t pin, uint8_t value) {
+    hostCounters.i2cTransactions++;
+    writes++;
+    if (value) outputs |= (1 << pin);
+    else outputs &= ~(1 << pin);
+    return true;
+  }
+};
+#endif
@@ -0,0 +1,32 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+#include "Arduino.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+// NVS stand-in: in-memory, per process. Counts writes so tools can
+// check flash wear.
+inline uint32_t hostNvsWrites = 0;
+
+class Preferences {
+public:
+  std::map<std::string, std::vector<uint8_t>> blobs;
+
+  bool begin(const char*, bool = false) { return true; }
+  void end() {}
+  size_t getBytes(const char* key, void* buf, size_t len) {
+    auto it = blobs.find(key);
+    if (it == blobs.end() || it->second.size() > len) return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+  }
+  size_t putBytes(const char* key, const void* buf, size_t len) {
+    hostNvsWrites++;
+    const uint8_t* p = (const uint8_t*)buf;
+    blobs[key].assign(p, p + len);
+    return len;
+  }
+};
+#endif
@@ -0,0 +1,40 @@
+#ifndef HOST_RTCLIB_H
+#define HOST_RTCLIB_H
+#include "Arduino.h"
+
+class DateTime {
+public:
+  uint32_t t;
+  explicit DateTime(uint32_t unixTime = 0) : t(unixTime) {}
+  DateTime(uint16_t y, uint8_t mo, uint8_t d, uint8_t h = 0, uint8_t mi = 0, uint8_t s = 0) {
+    struct tm tmv = {};
+    tmv.tm_year = y - 1900; tmv.tm_mon = mo - 1; tmv.tm_mday = d;
+    tmv.tm_hour = h; tmv.tm_min = mi; tmv.tm_sec = s;
+    t = (uint32_t)timegm(&tmv);
+  }
+  DateTime(const char*, const char*) : t(0) {}
+  struct tm parts() const { time_t v = t; struct tm out; gmtime_r(&v, &out); return out; }
+  uint16_t year() const { return parts().tm_year + 1900; }
+  uint8_t month() const { return parts().tm_mon + 1; }
+  uint8_t day() const { return parts().tm_mday; }
+  uint8_t hour() const { return parts().tm_hour; }
+  uint8_t minute() const { return parts().tm_min; }
+  uint8_t second() const { return parts().tm_sec; }
+  uint32_t unixtime() const { return t; }
+};
+
+// Wall clock = startUnix + virtual millis
+class RTC_DS3231 {
+public:
+  uint32_t startUnix = 1760000000;
+  uint32_t reads = 0;
+  bool begin() { hostCounters.i2cTransactions++; return true; }
+  bool lostPower() { return false; }
+  void adjust(const DateTime& dt) { startUnix = dt.unixtime() - millis() / 1000; }
+  DateTime now() {
+    hostCounters.i2cTransactions++;
+    reads++;
+    return DateTime(startUnix + millis() / 1000);
+  }
+};
+#endif
@@ -0,0 +1,17 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+#include "Arduino.h"
+
+#define WIFI_STA 1
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+
+class WiFiClass {
+public:
+  void mode(int) {}
+  void begin(const char*, const char*) {}
+  int status() { return WL_CONNECTED; }
+};
+
+inline WiFiClass WiFi;
+#endif
@@ -0,0 +1,13 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+#include "Arduino.h"
+
+class TwoWire {
+public:
+  void begin(int = -1, int = -1) {}
+  void beginTransmission(uint8_t) {}
+  uint8_t endTransmission() { hostCounters.i2cTransactions++; return 2; }  // nothing acks
+};
+
+inline TwoWire Wire;
+#endif
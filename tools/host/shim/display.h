@@ -0,0 +1,2 @@
+// The sketch keeps this module as display.txt; map the include name to it
+#include "../../../display.txt"
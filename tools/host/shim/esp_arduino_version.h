@@ -0,0 +1,4 @@
+#ifndef HOST_ESP_ARDUINO_VERSION_H
+#define HOST_ESP_ARDUINO_VERSION_H
+#define ESP_ARDUINO_VERSION_MAJOR 3
+#endif
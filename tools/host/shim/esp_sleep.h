@@ -0,0 +1,11 @@
+#ifndef HOST_ESP_SLEEP_H
+#define HOST_ESP_SLEEP_H
+#include <stdint.h>
+
+typedef enum { ESP_SLEEP_WAKEUP_UNDEFINED, ESP_SLEEP_WAKEUP_TIMER, ESP_SLEEP_WAKEUP_GPIO } esp_sleep_wakeup_cause_t;
+
+inline int esp_sleep_enable_gpio_wakeup() { return 0; }
+inline int esp_sleep_enable_timer_wakeup(uint64_t) { return 0; }
+inline int esp_light_sleep_start() { return 0; }
+inline esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() { return ESP_SLEEP_WAKEUP_TIMER; }
+#endif
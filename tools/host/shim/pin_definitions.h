@@ -0,0 +1,2 @@
+// The sketch keeps this module as pin_definitions.txt; map the include name to it
+#include "../../../pin_definitions.txt"
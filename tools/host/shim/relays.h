@@ -0,0 +1,2 @@
+// The sketch keeps this module as relays.txt; map the include name to it
+#include "../../../relays.txt"
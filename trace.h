@@ -0,0 +1,788 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <RTClib.h>
+#include <PCF8574.h>
+#include "config.h"
+#include "pin_definitions.h"
+
+// ═══════════════════════════════════════════════════════════════
+// INPUT TRACE RECORDER
+// ═══════════════════════════════════════════════════════════════
+// Everything the control logic sees goes through the ctl* seam below:
+//
+//   ctlMillis()      loop-pass time (latched once per pass)
+//   ctlReadPin()     E-stop and ATO float GPIOs (registered slots)
+//   ctlReadButton()  button box expander pins
+//   ctlTempC()       raw probe readings (one channel per probe)
+//   ctlRtcNow()      wall clock (minute resolution)
+//   ctlRandom()      cloud randomness
+//   ctlIrReceive()   frames decoded on IR_RECV_PIN
+//   ctlConsoleRead() bytes typed at the serial console
+//
+// Each input is sampled at most once per pass and only changes are
+// recorded, delta-encoded into a byte ring. Relay and IR outputs are
+// logged too, so a replay can check it reproduced them exactly.
+// Idle passes (nothing recorded) that repeat the previous pass's wake
+// sources and interval collapse into one REPEAT record.
+// tools/host/replay.cpp feeds a dumped trace back through the
+// unmodified handlers.
+//
+// Only changes are recorded, so a replay has to start from known
+// state. Until the ring wraps that is the boot record. After that,
+// a keyframe every TRACE_KEYFRAME_SPACING bytes holds the last input
+// levels and the controller state (controllerKeyframe(), watchdog.h),
+// and the ring always drops through to the next keyframe, so a
+// wrapped trace starts at one.
+
+// Record types (high nibble of the header byte; low nibble = extra)
+enum TraceType : uint8_t {
+  TRACE_BOOT,      // varint: absolute ms
+  TRACE_PASS,      // extra: wake sources, varint: ms since previous pass
+  TRACE_PIN,       // extra: (input << 1) | level
+  TRACE_BUTTON,    // extra: (expander pin << 1) | level
+  TRACE_TEMP,      // extra: channel, zigzag varint: raw delta (1/128 °C)
+  TRACE_RTC,       // zigzag varint: minutes delta
+  TRACE_RANDOM,    // zigzag varint: value
+  TRACE_RELAY,     // byte: relayStates
+  TRACE_IR,        // extra: repeats, byte: command
+  TRACE_IR_RX,     // extra: IR_RX_* flags, byte: command
+  TRACE_CONSOLE,   // byte: console input byte
+  TRACE_KEYFRAME,  // varint: pass ms, varint: length, state bytes
+  TRACE_REPEAT     // varint: idle passes with the last PASS's wakes and interval
+};
+
+// Direct GPIO inputs: slot 0 is the E-stop, tanks register their
+// floats (traceRegisterPin) in config order, so slots match on replay
+typedef uint8_t TracePin;
+const uint8_t TRACE_PIN_SLOTS = 8;      // 3 bits in the record
+const TracePin TRACE_PIN_ESTOP = 0;
+const TracePin TRACE_PIN_NONE = 0xFF;
+
+uint8_t tracePinGpio[TRACE_PIN_SLOTS] = { ESTOP_BUTTON_PIN };
+uint8_t tracePinCount = 1;
+
+// External references
+extern RTC_DS3231 rtc;
+
+const uint8_t TRACE_TEMP_CHANNELS = TEMP_PROBE_MAX;  // one per registered probe
+const float TRACE_TEMP_SCALE = 128.0;   // fixed-point steps per °C (the DS18B20 resolves 1/16)
+
+const uint32_t TRACE_KEYFRAME_SPACING = TRACE_BUFFER_SIZE / 8;  // a wrap keeps >= 7/8 of the ring
+const uint16_t TRACE_KEYFRAME_MAX = 1024;                       // state bytes: ~180 board + ~210 per tank
+const uint32_t TRACE_NO_SEED = 0xFFFFFFFF;
+
+// Dump: 32-byte hex lines, a few per pass so the loop keeps running
+const uint8_t TRACE_DUMP_LINES_PER_PASS = 4;
+const unsigned long TRACE_DUMP_POLL_MS = 25;
+
+// Keyframe state: each module walks its own state through field(),
+// which writes it when recording and reads it back when a replay
+// seeds from the keyframe, so the two can't drift apart.
+struct TraceKeyframe {
+  uint8_t* buf;
+  uint16_t size;
+  uint16_t pos;
+  bool loading;
+  bool ok;
+
+  template <typename T> void field(T& v) {
+    static_assert(sizeof(T) <= 4, "millis values go through ms()");
+    if (pos + sizeof(T) > size) {
+      ok = false;
+      return;
+    }
+    if (loading) memcpy(&v, buf + pos, sizeof(T));
+    else memcpy(buf + pos, &v, sizeof(T));
+    pos += sizeof(T);
+  }
+
+  // Timestamps and durations: 32 bits on the board, wider on the host
+  void ms(unsigned long& v) {
+    uint32_t w = v;
+    field(w);
+    if (loading) v = w;
+  }
+};
+
+// Recorder state
+uint8_t traceBuf[TRACE_BUFFER_SIZE];
+uint32_t traceHead = 0;          // oldest byte
+uint32_t traceLen = 0;           // bytes in use
+bool traceWrapped = false;       // oldest records were dropped
+unsigned long traceBaseTime = 0; // pass time just before the oldest retained record
+bool traceEnabled = true;
+uint32_t traceDropped = 0;       // bytes dropped from the front, ever
+uint32_t traceSinceKeyframe = 0; // bytes appended since the last keyframe
+uint16_t traceKeyframes = 0;     // keyframes in the ring
+unsigned long traceDropInterval = 0;   // interval of the last dropped PASS
+
+// Idle run being collected: passes after the last PASS record with the
+// same wakes and interval and nothing recorded, not yet written out
+bool traceIdleOpen = false;      // nothing appended since the last PASS
+uint8_t traceIdleWakes = 0;
+unsigned long traceIdleInterval = 0;
+uint32_t traceIdleRun = 0;
+uint32_t traceIdlePass = 0;      // pass that last joined the run
+
+// Dump in progress (positions count from the first byte ever recorded)
+Print* traceDumpOut = nullptr;
+uint32_t traceDumpStartPos = 0;
+uint32_t traceDumpPos = 0;
+uint32_t traceDumpEnd = 0;
+uint32_t traceDumpSum = 0;
+
+// Replay state (only the host replay tool sets this)
+bool traceReplayActive = false;
+uint32_t traceCursor = 0;        // offset from traceHead
+uint32_t traceDivergences = 0;
+uint32_t traceSeedAt = TRACE_NO_SEED;   // keyframe the replay starts from
+uint32_t traceReplayRepeats = 0;         // idle passes left from a REPEAT
+uint8_t traceReplayWakes = 0;
+unsigned long traceReplayInterval = 0;
+
+// Pass state
+unsigned long ctlNow = 0;
+unsigned long tracePassTime = 0;
+uint32_t ctlPassId = 0;
+
+// Last recorded / replayed value per input, and the pass it was sampled in
+uint8_t tracePinLevel[TRACE_PIN_SLOTS];
+uint32_t tracePinPass[TRACE_PIN_SLOTS];
+uint8_t traceButtonLevel[8];
+uint32_t traceButtonPass[8];
+int16_t traceTempRaw[TRACE_TEMP_CHANNELS];
+uint32_t traceRtcMinutes = 0;
+uint32_t traceRtcPass = 0;
+
+// Recording side only: one expander read serves every button in a
+// pass, and the RTC is read once a minute with millis() carrying the
+// seconds in between
+uint8_t traceExpanderInputs = 0xFF;
+uint32_t traceExpanderPass = 0;
+uint32_t rtcCarrySeconds = 0;       // unixtime at the last read
+unsigned long rtcCarryReadMs = 0;
+bool rtcCarryValid = false;
+
+// Function declarations
+void traceBegin();
+TracePin traceRegisterPin(uint8_t gpio);
+void ctlBeginPass(uint8_t wakes);
+unsigned long ctlMillis();
+bool ctlReadPin(TracePin input);
+bool ctlReadButton(PCF8574* expander, uint8_t pin);
+float ctlTempC(uint8_t channel, float measuredC);
+DateTime ctlRtcNow();
+DateTime rtcCarriedNow();
+long ctlRandom(long lo, long hi);
+bool ctlIrReceive(uint8_t& command, uint8_t& flags);
+bool ctlConsoleRead(uint8_t& c);
+void traceOutput(TraceType type, uint8_t value, uint8_t extra = 0);
+bool traceKeyframeDue();
+void traceKeyframe();
+bool traceKeyframePending();
+void traceRestoreKeyframe();
+bool traceDumpStart(Print& out);
+bool traceDumpService();
+bool traceDumpActive();
+uint32_t traceReadVarint(uint32_t& offset);
+void traceAppend(const uint8_t* rec, uint16_t len);
+
+// Forward declarations
+void controllerKeyframe(TraceKeyframe& k);   // watchdog.h
+
+// ═══════════════════════════════════════════════════════════════
+// RING BUFFER
+// ═══════════════════════════════════════════════════════════════
+
+uint8_t traceByteAt(uint32_t offset) {
+  return traceBuf[(traceHead + offset) % TRACE_BUFFER_SIZE];
+}
+
+uint32_t traceVarintLen(uint32_t offset) {
+  uint32_t n = 1;
+  while ((traceByteAt(offset + n - 1) & 0x80) && offset + n < traceLen) n++;
+  return n;
+}
+
+// Length of the record starting at `offset`
+uint32_t traceRecordLen(uint32_t offset) {
+  switch (traceByteAt(offset) >> 4) {
+    case TRACE_KEYFRAME: {
+      uint32_t p = offset + 1 + traceVarintLen(offset + 1);
+      uint32_t size = traceReadVarint(p);
+      return p - offset + size;
+    }
+    case TRACE_BOOT:
+    case TRACE_PASS:
+    case TRACE_REPEAT:
+    case TRACE_TEMP:
+    case TRACE_RTC:
+    case TRACE_RANDOM:
+      return 1 + traceVarintLen(offset + 1);
+    case TRACE_RELAY:
+    case TRACE_IR:
+    case TRACE_IR_RX:
+    case TRACE_CONSOLE:
+      return 2;
+    default:
+      return 1;
+  }
+}
+
+void traceDropOldest() {
+  uint32_t drop = traceRecordLen(0);
+  uint8_t type = traceByteAt(0) >> 4;
+  if (type == TRACE_BOOT || type == TRACE_PASS || type == TRACE_KEYFRAME || type == TRACE_REPEAT) {
+    uint32_t offset = 1;
+    uint32_t v = traceReadVarint(offset);
+    if (type == TRACE_PASS) {
+      traceBaseTime += v;
+      traceDropInterval = v;
+    } else if (type == TRACE_REPEAT) {
+      traceBaseTime += v * traceDropInterval;
+    } else {
+      traceBaseTime = v;
+    }
+  }
+  if (type == TRACE_KEYFRAME) traceKeyframes--;
+  traceHead = (traceHead + drop) % TRACE_BUFFER_SIZE;
+  traceLen -= drop;
+  traceDropped += drop;
+  traceWrapped = true;
+}
+
+// Oldest record, then on to the next keyframe if there is one: what
+// precedes it can't be replayed once its own seed is gone
+void traceDropToKeyframe() {
+  traceDropOldest();
+  while (traceKeyframes > 0 && (traceByteAt(0) >> 4) != TRACE_KEYFRAME) traceDropOldest();
+}
+
+uint8_t tracePutVarint(uint8_t* p, uint32_t v);
+
+// Write out the idle run. A pass that joined it and then records
+// something gets its own PASS record back, so a REPEAT never has
+// records after it that belong to one of its passes.
+void traceFlushIdle() {
+  uint32_t run = traceIdleRun;
+  traceIdleRun = 0;
+  bool current = (traceIdlePass == ctlPassId);
+  if (current) run--;
+  uint8_t rec[6];
+  if (run > 0) {
+    rec[0] = TRACE_REPEAT << 4;
+    traceAppend(rec, 1 + tracePutVarint(rec + 1, run));
+  }
+  if (current) {
+    rec[0] = (TRACE_PASS << 4) | (traceIdleWakes & 0x0F);
+    traceAppend(rec, 1 + tracePutVarint(rec + 1, traceIdleInterval));
+  }
+}
+
+void traceAppend(const uint8_t* rec, uint16_t len) {
+  if (traceIdleRun) traceFlushIdle();
+  traceIdleOpen = false;
+  while (traceLen + len > TRACE_BUFFER_SIZE) traceDropToKeyframe();
+  for (uint16_t i = 0; i < len; i++) {
+    traceBuf[(traceHead + traceLen + i) % TRACE_BUFFER_SIZE] = rec[i];
+  }
+  traceLen += len;
+  traceSinceKeyframe += len;
+}
+
+uint8_t tracePutVarint(uint8_t* p, uint32_t v) {
+  uint8_t n = 0;
+  do {
+    uint8_t b = v & 0x7F;
+    v >>= 7;
+    p[n++] = b | (v ? 0x80 : 0);
+  } while (v);
+  return n;
+}
+
+uint32_t traceZigzag(int32_t v) {
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+int32_t traceUnzigzag(uint32_t v) {
+  return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+void traceRecord(TraceType type, uint8_t extra, bool hasVarint, uint32_t varint) {
+  if (!traceEnabled || traceReplayActive) return;
+  uint8_t rec[6];
+  rec[0] = (type << 4) | (extra & 0x0F);
+  uint8_t len = 1;
+  if (hasVarint) len += tracePutVarint(rec + 1, varint);
+  traceAppend(rec, len);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// REPLAY CURSOR
+// ═══════════════════════════════════════════════════════════════
+
+bool traceAtEnd() {
+  return traceCursor >= traceLen;
+}
+
+uint8_t tracePeekType() {
+  return traceAtEnd() ? 0xFF : traceByteAt(traceCursor) >> 4;
+}
+
+uint8_t tracePeekExtra() {
+  return traceByteAt(traceCursor) & 0x0F;
+}
+
+uint32_t traceReadVarint(uint32_t& offset) {
+  uint32_t v = 0;
+  uint8_t shift = 0;
+  uint8_t b;
+  do {
+    b = traceByteAt(offset++);
+    v |= (uint32_t)(b & 0x7F) << shift;
+    shift += 7;
+  } while ((b & 0x80) && shift < 35);
+  return v;
+}
+
+// Consume the record under the cursor; returns its varint/byte payload
+uint32_t traceConsume() {
+  uint8_t type = tracePeekType();
+  uint32_t offset = traceCursor + 1;
+  uint32_t value = 0;
+  if (type == TRACE_RELAY || type == TRACE_IR || type == TRACE_IR_RX || type == TRACE_CONSOLE) {
+    value = traceByteAt(offset++);
+  } else if (type == TRACE_KEYFRAME) {
+    offset = traceCursor + traceRecordLen(traceCursor);
+    uint32_t p = traceCursor + 1;
+    value = traceReadVarint(p);
+  } else if (type != TRACE_PIN && type != TRACE_BUTTON) {
+    value = traceReadVarint(offset);
+  }
+  traceCursor = offset;
+  return value;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// SEAM: TIME
+// ═══════════════════════════════════════════════════════════════
+
+// Start of setup(): the boot record is the first pass. On replay the
+// loaded trace is kept and the cursor rewound instead; a wrapped trace
+// starts at a keyframe, which setup() restores once the tanks exist.
+void traceBegin() {
+  traceCursor = 0;
+  traceSeedAt = TRACE_NO_SEED;
+  traceReplayRepeats = 0;
+  ctlPassId = 1;
+
+  if (traceReplayActive) {
+    ctlNow = traceBaseTime;
+    if (tracePeekType() == TRACE_BOOT) {
+      ctlNow = traceConsume();
+    } else if (tracePeekType() == TRACE_KEYFRAME) {
+      traceSeedAt = traceCursor;
+      ctlNow = traceConsume();
+    }
+  } else {
+    traceHead = 0;
+    traceLen = 0;
+    traceWrapped = false;
+    traceBaseTime = 0;
+    traceDropped = 0;
+    traceSinceKeyframe = 0;
+    traceKeyframes = 0;
+    traceIdleOpen = false;
+    traceIdleRun = 0;
+    ctlNow = millis();
+    traceRecord(TRACE_BOOT, 0, true, ctlNow);
+  }
+  tracePassTime = ctlNow;
+}
+
+// Returns the slot for a GPIO, adding it if new; TRACE_PIN_NONE if
+// the pin is not fitted or the slots are used up
+TracePin traceRegisterPin(uint8_t gpio) {
+  if (gpio == PIN_NONE) return TRACE_PIN_NONE;
+  for (uint8_t i = 0; i < tracePinCount; i++) {
+    if (tracePinGpio[i] == gpio) return i;
+  }
+  if (tracePinCount == TRACE_PIN_SLOTS) {
+    Serial.printf("✗ No trace slot for GPIO %u (max %u inputs)\n", gpio, TRACE_PIN_SLOTS);
+    return TRACE_PIN_NONE;
+  }
+  tracePinGpio[tracePinCount] = gpio;
+  return tracePinCount++;
+}
+
+// Start of a loop pass: latch time, note why we woke
+void ctlBeginPass(uint8_t wakes) {
+  ctlPassId++;
+
+  if (traceReplayActive) {
+    if (traceReplayRepeats == 0) {
+      while (!traceAtEnd() && tracePeekType() != TRACE_PASS && tracePeekType() != TRACE_REPEAT) {
+        if (tracePeekType() != TRACE_KEYFRAME) traceDivergences++;   // inputs/outputs the replay never asked for
+        traceConsume();
+      }
+      if (traceAtEnd()) return;
+      if (tracePeekType() == TRACE_PASS) {
+        traceReplayWakes = tracePeekExtra();
+        traceReplayInterval = traceConsume();
+        traceReplayRepeats = 1;
+      } else {
+        traceReplayRepeats = traceConsume();
+        if (traceReplayRepeats == 0) return;
+      }
+    }
+    traceReplayRepeats--;
+    ctlNow = tracePassTime + traceReplayInterval;
+  } else {
+    ctlNow = millis();
+    unsigned long interval = ctlNow - tracePassTime;
+    if (traceEnabled && traceIdleOpen && wakes == traceIdleWakes && interval == traceIdleInterval) {
+      traceIdleRun++;
+      traceIdlePass = ctlPassId;
+    } else {
+      traceRecord(TRACE_PASS, wakes, true, interval);
+      traceIdleOpen = traceEnabled;
+      traceIdleWakes = wakes;
+      traceIdleInterval = interval;
+    }
+  }
+  tracePassTime = ctlNow;
+}
+
+// Replay: is there another pass to run (host tool only)
+bool traceNextPassReady() {
+  return traceReplayRepeats > 0 || tracePeekType() == TRACE_PASS || tracePeekType() == TRACE_REPEAT;
+}
+
+// Wake sources of the next replayed pass (host tool only)
+uint8_t traceNextPassWakes() {
+  if (traceReplayRepeats > 0 || tracePeekType() == TRACE_REPEAT) return traceReplayWakes;
+  return tracePeekType() == TRACE_PASS ? tracePeekExtra() : 0;
+}
+
+unsigned long ctlMillis() {
+  return ctlNow;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// SEAM: INPUTS
+// ═══════════════════════════════════════════════════════════════
+
+bool ctlReadPin(TracePin input) {
+  if (input >= tracePinCount) return HIGH;
+  if (tracePinPass[input] == ctlPassId) return tracePinLevel[input];
+  tracePinPass[input] = ctlPassId;
+
+  if (traceReplayActive) {
+    if (tracePeekType() == TRACE_PIN && (tracePeekExtra() >> 1) == input) {
+      tracePinLevel[input] = tracePeekExtra() & 1;
+      traceConsume();
+    }
+    return tracePinLevel[input];
+  }
+
+  uint8_t level = digitalRead(tracePinGpio[input]) ? 1 : 0;
+  if (level != tracePinLevel[input]) {
+    tracePinLevel[input] = level;
+    traceRecord(TRACE_PIN, (input << 1) | level, false, 0);
+  }
+  return level;
+}
+
+bool ctlReadButton(PCF8574* expander, uint8_t pin) {
+  pin &= 0x07;
+  if (traceButtonPass[pin] == ctlPassId) return traceButtonLevel[pin];
+  traceButtonPass[pin] = ctlPassId;
+
+  if (traceReplayActive) {
+    if (tracePeekType() == TRACE_BUTTON && (tracePeekExtra() >> 1) == pin) {
+      traceButtonLevel[pin] = tracePeekExtra() & 1;
+      traceConsume();
+    }
+    return traceButtonLevel[pin];
+  }
+
+  // The button box is the only expander read; one I2C read per pass
+  if (traceExpanderPass != ctlPassId) {
+    traceExpanderPass = ctlPassId;
+    PCF8574::DigitalInput in = expander->digitalReadAll();
+    traceExpanderInputs = in.p0 | (in.p1 << 1) | (in.p2 << 2) | (in.p3 << 3) |
+                          (in.p4 << 4) | (in.p5 << 5) | (in.p6 << 6) | (in.p7 << 7);
+  }
+
+  uint8_t level = (traceExpanderInputs >> pin) & 1;
+  if (level != traceButtonLevel[pin]) {
+    traceButtonLevel[pin] = level;
+    traceRecord(TRACE_BUTTON, (pin << 1) | level, false, 0);
+  }
+  return level;
+}
+
+// Probe readings are stored in TRACE_TEMP_SCALE steps. DS18B20 counts
+// (1/16 °C) fall on that grid, so the replayed float is bit-identical
+// to what the scratchpad held
+float ctlTempC(uint8_t channel, float measuredC) {
+  if (traceReplayActive) {
+    if (tracePeekType() == TRACE_TEMP && tracePeekExtra() == channel) {
+      traceTempRaw[channel] += traceUnzigzag(traceConsume());
+    }
+    return traceTempRaw[channel] / TRACE_TEMP_SCALE;
+  }
+
+  int16_t raw = (int16_t)lround(measuredC * TRACE_TEMP_SCALE);
+  if (raw != traceTempRaw[channel]) {
+    traceRecord(TRACE_TEMP, channel, true, traceZigzag(raw - traceTempRaw[channel]));
+    traceTempRaw[channel] = raw;
+  }
+  return measuredC;
+}
+
+// Wall clock for the recording side. The DS3231 is only read when the
+// carried clock reaches a new minute (or on first use), so every minute
+// change still comes from the RTC: about 60 reads an hour, whatever the
+// pass rate.
+DateTime rtcCarriedNow() {
+  unsigned long now = ctlMillis();
+  uint32_t seconds = rtcCarrySeconds + (now - rtcCarryReadMs) / 1000;
+  if (!rtcCarryValid || seconds / 60 != rtcCarrySeconds / 60) {
+    rtcCarrySeconds = rtc.now().unixtime();
+    rtcCarryReadMs = now;
+    rtcCarryValid = true;
+    seconds = rtcCarrySeconds;
+  }
+  return DateTime(seconds);
+}
+
+// Control logic only looks at hour/minute/day, so the clock is
+// sampled to the minute; one record per minute at most
+DateTime ctlRtcNow() {
+  if (traceRtcPass != ctlPassId) {
+    traceRtcPass = ctlPassId;
+
+    if (traceReplayActive) {
+      if (tracePeekType() == TRACE_RTC) {
+        traceRtcMinutes += traceUnzigzag(traceConsume());
+      }
+    } else {
+      uint32_t minutes = rtcCarriedNow().unixtime() / 60;
+      if (minutes != traceRtcMinutes) {
+        traceRecord(TRACE_RTC, 0, true, traceZigzag((int32_t)(minutes - traceRtcMinutes)));
+        traceRtcMinutes = minutes;
+      }
+    }
+  }
+  return DateTime(traceRtcMinutes * 60);
+}
+
+long ctlRandom(long lo, long hi) {
+  if (traceReplayActive) {
+    if (tracePeekType() == TRACE_RANDOM) return traceUnzigzag(traceConsume());
+    traceDivergences++;
+    return lo;
+  }
+  long value = random(lo, hi);
+  traceRecord(TRACE_RANDOM, 0, true, traceZigzag(value));
+  return value;
+}
+
+bool irDecodeNext(uint8_t& command, uint8_t& flags);   // ir_link.h
+
+// One decoded frame per call; false when none are pending
+bool ctlIrReceive(uint8_t& command, uint8_t& flags) {
+  if (traceReplayActive) {
+    if (tracePeekType() != TRACE_IR_RX) return false;
+    flags = tracePeekExtra();
+    command = traceConsume();
+    return true;
+  }
+
+  if (!irDecodeNext(command, flags)) return false;
+  if (traceEnabled) {
+    uint8_t rec[2] = { (uint8_t)((TRACE_IR_RX << 4) | (flags & 0x0F)), command };
+    traceAppend(rec, 2);
+  }
+  return true;
+}
+
+// One console byte per call; false when the UART has none. Commands
+// change setpoints and modes, so their input is traced like a button.
+bool ctlConsoleRead(uint8_t& c) {
+  if (traceReplayActive) {
+    if (tracePeekType() != TRACE_CONSOLE) return false;
+    c = traceConsume();
+    return true;
+  }
+
+  if (!Serial.available()) return false;
+  c = Serial.read();
+  if (traceEnabled) {
+    uint8_t rec[2] = { (uint8_t)(TRACE_CONSOLE << 4), c };
+    traceAppend(rec, 2);
+  }
+  return true;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// SEAM: OUTPUTS
+// ═══════════════════════════════════════════════════════════════
+
+// Hook for the replay tool to collect outputs
+void (*traceOutputSink)(TraceType type, uint8_t value, uint8_t extra, bool matched) = nullptr;
+
+void traceOutput(TraceType type, uint8_t value, uint8_t extra) {
+  if (extra > 0x0F) extra = 0x0F;
+
+  if (traceReplayActive) {
+    bool matched = false;
+    if (tracePeekType() == type && tracePeekExtra() == extra) {
+      matched = (traceConsume() == value);
+    }
+    if (!matched) traceDivergences++;
+    if (traceOutputSink) traceOutputSink(type, value, extra, matched);
+    return;
+  }
+
+  if (!traceEnabled) return;
+  uint8_t rec[2] = { (uint8_t)((type << 4) | extra), value };
+  traceAppend(rec, 2);
+}
+
+// ═══════════════════════════════════════════════════════════════
+// KEYFRAMES
+// ═══════════════════════════════════════════════════════════════
+
+// The seam's own part: last level of every input
+void traceKeyframeSeam(TraceKeyframe& k) {
+  for (uint8_t i = 0; i < TRACE_PIN_SLOTS; i++) k.field(tracePinLevel[i]);
+  for (uint8_t i = 0; i < 8; i++) k.field(traceButtonLevel[i]);
+  for (uint8_t i = 0; i < TRACE_TEMP_CHANNELS; i++) k.field(traceTempRaw[i]);
+  k.field(traceRtcMinutes);
+}
+
+// The caller picks a quiet point (nothing held, queued or half-typed),
+// so the state that is left fits in a few hundred bytes
+bool traceKeyframeDue() {
+  return traceEnabled && !traceReplayActive && traceSinceKeyframe >= TRACE_KEYFRAME_SPACING;
+}
+
+// End of a pass: the next PASS record continues from here
+void traceKeyframe() {
+  static uint8_t rec[11 + TRACE_KEYFRAME_MAX];
+  uint8_t* state = rec + 11;
+  TraceKeyframe k = { state, TRACE_KEYFRAME_MAX, 0, false, true };
+  traceKeyframeSeam(k);
+  controllerKeyframe(k);
+  traceSinceKeyframe = 0;
+  if (!k.ok) {
+    Serial.printf("✗ Trace keyframe over %u bytes, not written\n", TRACE_KEYFRAME_MAX);
+    return;
+  }
+
+  uint8_t hdr[11];
+  hdr[0] = TRACE_KEYFRAME << 4;
+  uint8_t n = 1 + tracePutVarint(hdr + 1, ctlNow);
+  n += tracePutVarint(hdr + n, k.pos);
+  memcpy(state - n, hdr, n);
+  traceAppend(state - n, n + k.pos);
+  traceKeyframes++;
+  traceSinceKeyframe = 0;
+}
+
+bool traceKeyframePending() {
+  return traceSeedAt != TRACE_NO_SEED;
+}
+
+// Replay of a wrapped trace: setup() calls this instead of starting
+// the tanks. A keyframe that doesn't parse back to the same length was
+// written by other firmware, and everything after it is suspect.
+void traceRestoreKeyframe() {
+  static uint8_t state[TRACE_KEYFRAME_MAX];
+  uint32_t offset = traceSeedAt + 1;
+  traceReadVarint(offset);   // pass time, already in ctlNow
+  uint32_t size = traceReadVarint(offset);
+  traceSeedAt = TRACE_NO_SEED;
+  if (size > TRACE_KEYFRAME_MAX) {
+    traceDivergences++;
+    return;
+  }
+  for (uint32_t i = 0; i < size; i++) state[i] = traceByteAt(offset + i);
+
+  TraceKeyframe k = { state, (uint16_t)size, 0, true, true };
+  traceKeyframeSeam(k);
+  controllerKeyframe(k);
+  if (!k.ok || k.pos != size) traceDivergences++;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// DUMP
+// ═══════════════════════════════════════════════════════════════
+
+// Text framing so it survives a terminal capture:
+//   TRACE BEGIN <bytes> <wrapped> <base ms>
+//   <hex, 32 bytes per line>
+//   TRACE END <sum>
+//
+// The ring is streamed a few lines per pass while recording goes on.
+// The dump covers the ring as it was at the start; room for what gets
+// recorded meanwhile is made first, so nothing undumped is dropped.
+// Other console output may land between the hex lines.
+bool traceDumpStart(Print& out) {
+  if (traceReplayActive) return true;   // a replayed `trace` command
+  if (traceDumpOut) return false;
+  if (traceIdleRun) traceFlushIdle();
+  while (traceKeyframes > 0 && TRACE_BUFFER_SIZE - traceLen < TRACE_KEYFRAME_SPACING) {
+    traceDropToKeyframe();
+  }
+
+  out.print("TRACE BEGIN ");
+  out.print(traceLen);
+  out.print(" ");
+  out.print(traceWrapped ? 1 : 0);
+  out.print(" ");
+  out.println(traceBaseTime);
+
+  traceDumpOut = &out;
+  traceDumpStartPos = traceDropped;
+  traceDumpPos = traceDropped;
+  traceDumpEnd = traceDropped + traceLen;
+  traceDumpSum = 0;
+  return true;
+}
+
+// Every pass; false once the dump is finished (or none is running)
+bool traceDumpService() {
+  if (!traceDumpOut) return false;
+  Print& out = *traceDumpOut;
+
+  if (traceDumpPos < traceDropped) {
+    out.println("TRACE ABORTED (overwritten)");
+    traceDumpOut = nullptr;
+    return false;
+  }
+
+  for (uint16_t n = 0; n < TRACE_DUMP_LINES_PER_PASS * 32 && traceDumpPos < traceDumpEnd; n++) {
+    uint8_t b = traceByteAt(traceDumpPos - traceDropped);
+    traceDumpSum = traceDumpSum * 31 + b;
+    if (b < 0x10) out.print("0");
+    out.print(b, HEX);
+    traceDumpPos++;
+    if ((traceDumpPos - traceDumpStartPos) % 32 == 0 || traceDumpPos == traceDumpEnd) out.println();
+  }
+
+  if (traceDumpPos < traceDumpEnd) return true;
+  out.print("TRACE END ");
+  out.println(traceDumpSum, HEX);
+  traceDumpOut = nullptr;
+  return false;
+}
+
+bool traceDumpActive() {
+  return traceDumpOut != nullptr;
+}
+
+#endif
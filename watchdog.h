@@ -0,0 +1,351 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <esp_task_wdt.h>
+#include <esp_system.h>
+#include <esp_arduino_version.h>
+#include <PCF8574.h>
+#include "config.h"
+#include "pin_definitions.h"
+#include "trace.h"
+#include "faults.h"
+#include "tank.h"
+
+// ═══════════════════════════════════════════════════════════════
+// TASK WATCHDOG + WARM RESTART
+// ═══════════════════════════════════════════════════════════════
+// The loop task is registered with the ESP32 task watchdog, but it is
+// only fed while every subsystem that has started keeps beating. A hung
+// I2C/OneWire call (or a handler that silently stops running) ends in
+// a watchdog reset.
+//
+// Critical state is mirrored into RTC slow memory every tick. RTC
+// memory survives watchdog, panic and brownout resets, so setup() can take a
+// warm path that restores it instead of cold-starting. If the restored
+// state is what keeps crashing the board, WATCHDOG_WARM_BOOT_LIMIT warm
+// boots in a row without a stable period fall back to a cold start.
+
+const uint32_t WATCHDOG_TIMEOUT_MS = 15000;
+const uint32_t WATCHDOG_SNAPSHOT_MAGIC = 0xA0C0FFEE;
+const uint8_t WATCHDOG_SNAPSHOT_VERSION = 5;
+const uint32_t WATCHDOG_DIAG_MAGIC = 0xA0C0D1A6;
+const uint8_t WATCHDOG_WARM_BOOT_LIMIT = 3;        // consecutive, then cold start
+const unsigned long WATCHDOG_STABLE_MS = 600000;   // 10 min up clears the streak
+
+enum WatchdogTask : uint8_t {
+  WDT_TASK_BUTTONS,
+  WDT_TASK_SENSORS,
+  WDT_TASK_FAULTS,
+  WDT_TASK_HEATERS,
+  WDT_TASK_FEED,
+  WDT_TASK_ATO,
+  WDT_TASK_LIGHTING,
+  WDT_TASK_CLOUDS,
+  WDT_TASK_LEDS,
+  WDT_TASK_STATUS,
+  WDT_TASK_ENERGY,
+  WDT_TASK_COUNT,
+  WDT_TASK_NONE = 0xFF
+};
+
+struct WatchdogTaskDef {
+  const char* name;
+  uint32_t maxSilenceMs;   // longest allowed gap between heartbeats
+};
+
+const WatchdogTaskDef WATCHDOG_TASKS[WDT_TASK_COUNT] = {
+  { "buttons",  10000 },
+  { "sensors",  10000 },
+  { "faults",   10000 },
+  { "heaters",  10000 },
+  { "feed",     10000 },
+  { "ato",      10000 },
+  { "lighting", 10000 },
+  { "clouds",   10000 },
+  { "leds",     10000 },
+  { "status",   10000 },
+  { "energy",   10000 },
+};
+
+// Snapshot of state that must survive a crash (millis-based times are
+// stored as elapsed ms, since millis() restarts at 0). Board-wide
+// state plus one TankSnapshot per tank.
+struct ControllerSnapshot {
+  uint32_t magic;
+  uint8_t version;
+  bool emergencyStop;
+  bool manualEstopLatched;
+  bool alarmSilenced;
+  uint8_t relayStates;
+  uint16_t faultLatched;
+  uint8_t tankCount;
+  TankSnapshot tanks[TANK_MAX];
+  uint32_t crc;              // over everything above
+};
+
+// Diagnostics live outside the CRC so the per-handler write is one store
+struct WatchdogDiag {
+  uint32_t magic;
+  uint8_t lastTask;          // handler that was running at the last beat
+  uint8_t warmStreak;        // warm boots since the last stable period
+  uint32_t warmBoots;        // lifetime
+};
+
+RTC_NOINIT_ATTR ControllerSnapshot rtcSnapshot;
+RTC_NOINIT_ATTR WatchdogDiag rtcDiag;
+
+// External references
+extern PCF8574 relayBox;
+extern uint8_t relayStates;
+extern bool emergencyStop;
+extern bool manualEstopLatched;
+extern bool alarmSilenced;
+extern unsigned long lastTickTime;
+extern unsigned long bootTime;
+
+// Forward declarations
+void tempKeyframe(TraceKeyframe& k);   // temperature.h
+
+// Boot diagnostics (valid after watchdogCheckWarmBoot)
+esp_reset_reason_t bootResetReason = ESP_RST_UNKNOWN;
+uint8_t bootLastTask = WDT_TASK_NONE;
+
+unsigned long watchdogLastBeat[WDT_TASK_COUNT];
+uint16_t watchdogStartedMask = 0;   // tasks that have beaten at least once
+bool watchdogArmed = false;
+
+// Function declarations
+void watchdogBegin();
+void watchdogBeat(WatchdogTask task);
+void watchdogService();
+bool watchdogCheckWarmBoot();
+void watchdogSaveSnapshot();
+void watchdogRestoreSnapshot();
+void controllerKeyframe(TraceKeyframe& k);
+const char* resetReasonName(esp_reset_reason_t reason);
+
+// ═══════════════════════════════════════════════════════════════
+// HEARTBEATS
+// ═══════════════════════════════════════════════════════════════
+
+void watchdogBegin() {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  esp_task_wdt_config_t cfg = {
+    .timeout_ms = WATCHDOG_TIMEOUT_MS,
+    .idle_core_mask = 0,
+    .trigger_panic = true
+  };
+  if (esp_task_wdt_reconfigure(&cfg) != ESP_OK) {
+    esp_task_wdt_init(&cfg);
+  }
+#else
+  esp_task_wdt_init(WATCHDOG_TIMEOUT_MS / 1000, true);
+#endif
+  esp_task_wdt_add(NULL);  // the loop task
+  watchdogArmed = true;
+  Serial.printf("✓ Task watchdog armed (%lu s)\n", (unsigned long)(WATCHDOG_TIMEOUT_MS / 1000));
+}
+
+// Called right before each handler runs; also records it for post-mortem
+void watchdogBeat(WatchdogTask task) {
+  watchdogLastBeat[task] = millis();
+  watchdogStartedMask |= (1 << task);
+  rtcDiag.lastTask = task;
+}
+
+// Feed the hardware watchdog only if no started task has gone silent
+void watchdogService() {
+  if (!watchdogArmed) return;
+
+  static uint16_t reportedMask = 0;
+  unsigned long now = millis();
+
+  uint16_t silent = 0;
+  for (uint8_t i = 0; i < WDT_TASK_COUNT; i++) {
+    if (!(watchdogStartedMask & (1 << i))) continue;
+    if (now - watchdogLastBeat[i] > WATCHDOG_TASKS[i].maxSilenceMs) silent |= (1 << i);
+  }
+
+  if (silent == 0) {
+    esp_task_wdt_reset();
+    reportedMask = 0;
+    if (rtcDiag.warmStreak && now >= WATCHDOG_STABLE_MS) rtcDiag.warmStreak = 0;
+    return;
+  }
+
+  uint16_t fresh = silent & ~reportedMask;
+  for (uint8_t i = 0; fresh; i++, fresh >>= 1) {
+    if (fresh & 1) Serial.printf("🐕 Watchdog: task '%s' silent, not feeding\n", WATCHDOG_TASKS[i].name);
+  }
+  reportedMask = silent;
+}
+
+// ═══════════════════════════════════════════════════════════════
+// RTC SNAPSHOT
+// ═══════════════════════════════════════════════════════════════
+
+uint32_t snapshotCrc(const ControllerSnapshot& s) {
+  const uint8_t* p = (const uint8_t*)&s;
+  size_t len = offsetof(ControllerSnapshot, crc);
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= p[i];
+    for (uint8_t b = 0; b < 8; b++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+// Called once per tick; a few dozen bytes of RAM writes
+void watchdogSaveSnapshot() {
+  ControllerSnapshot s;
+  memset(&s, 0, sizeof(s));   // padding bytes are part of the CRC
+  s.magic = WATCHDOG_SNAPSHOT_MAGIC;
+  s.version = WATCHDOG_SNAPSHOT_VERSION;
+  s.emergencyStop = emergencyStop;
+  s.manualEstopLatched = manualEstopLatched;
+  s.alarmSilenced = alarmSilenced;
+  s.relayStates = relayStates;
+  s.faultLatched = faultBoard.latched;
+  s.tankCount = tankCount;
+  for (uint8_t i = 0; i < tankCount; i++) tanks[i].save(s.tanks[i]);
+  s.crc = snapshotCrc(s);
+  rtcSnapshot = s;
+}
+
+bool snapshotValid() {
+  return rtcSnapshot.magic == WATCHDOG_SNAPSHOT_MAGIC &&
+         rtcSnapshot.version == WATCHDOG_SNAPSHOT_VERSION &&
+         rtcSnapshot.crc == snapshotCrc(rtcSnapshot);
+}
+
+// Decide cold vs warm boot. Crash-type and brownout resets with an
+// intact snapshot go warm; power-on and deliberate resets always
+// cold-start. A brownout restores everything (a manual E-stop stays
+// stopped) except the heaters, the big loads, which wait for
+// controlHeaters() to switch them back on.
+bool watchdogCheckWarmBoot() {
+  bootResetReason = esp_reset_reason();
+  if (rtcDiag.magic == WATCHDOG_DIAG_MAGIC) {
+    bootLastTask = rtcDiag.lastTask;
+  } else {
+    rtcDiag.magic = WATCHDOG_DIAG_MAGIC;
+    rtcDiag.warmStreak = 0;
+    rtcDiag.warmBoots = 0;
+  }
+  rtcDiag.lastTask = WDT_TASK_NONE;
+
+  bool warmReset = (bootResetReason == ESP_RST_TASK_WDT ||
+                    bootResetReason == ESP_RST_INT_WDT ||
+                    bootResetReason == ESP_RST_WDT ||
+                    bootResetReason == ESP_RST_PANIC ||
+                    bootResetReason == ESP_RST_BROWNOUT);
+
+  if (!warmReset || !snapshotValid()) {
+    rtcDiag.warmStreak = 0;
+    return false;
+  }
+
+  // The snapshot may be what crashes us: drop it and start clean
+  if (rtcDiag.warmStreak >= WATCHDOG_WARM_BOOT_LIMIT) {
+    Serial.printf("\n⚠️  %u warm restarts in a row - discarding snapshot, cold start\n", rtcDiag.warmStreak);
+    rtcSnapshot.magic = 0;
+    rtcDiag.warmStreak = 0;
+    return false;
+  }
+
+  rtcDiag.warmStreak++;
+  rtcDiag.warmBoots++;
+  return true;
+}
+
+// Runs after the hardware is initialized on the warm path
+void watchdogRestoreSnapshot() {
+  const ControllerSnapshot& s = rtcSnapshot;
+  unsigned long now = ctlMillis();
+
+  emergencyStop = s.emergencyStop;
+  manualEstopLatched = s.manualEstopLatched;
+  alarmSilenced = s.alarmSilenced;
+
+  // Tanks come from TANK_CONFIGS, so the same firmware has the same
+  // tanks; anything beyond the snapshot cold-starts
+  for (uint8_t i = 0; i < tankCount; i++) {
+    if (i < s.tankCount) tanks[i].restore(s.tanks[i], now);
+    else tanks[i].start();
+  }
+
+  faultBoard.latched = s.faultLatched;
+  faultBoard.active = faultBoard.stable | faultBoard.latched;
+  faultSummarize();
+
+  // Outputs: restore relays as they were, except the ATO pumps, which
+  // restart from the floats rather than resuming a run blind, and after
+  // a brownout the heaters
+  bool brownout = (bootResetReason == ESP_RST_BROWNOUT);
+  relayStates = s.relayStates;
+  for (uint8_t i = 0; i < tankCount; i++) {
+    TankController& t = tanks[i];
+    uint8_t pump = t.cfg->relays.atoPump;
+    if (pump != RELAY_NONE) relayStates |= (1 << pump);
+    if (!brownout) continue;
+    uint8_t heaters[2] = { t.cfg->relays.heaterPrimary, t.cfg->relays.heaterBackup };
+    for (uint8_t h : heaters) {
+      if (h != RELAY_NONE) relayStates |= (1 << h);
+    }
+    t.heaterPrimaryOn = false;
+    t.heaterBackupOn = false;
+  }
+  if (brownout) Serial.println("  Brownout: heaters held off until the next control pass");
+  for (int i = 0; i < 8; i++) {
+    relayBox.digitalWrite(i, (relayStates >> i) & 0x01);
+  }
+}
+
+// Trace keyframe (trace.h): the full controller state, where the RTC
+// snapshot only keeps what a restart must not lose
+void controllerKeyframe(TraceKeyframe& k) {
+  k.field(emergencyStop);
+  k.field(manualEstopLatched);
+  k.field(alarmSilenced);
+  k.field(relayStates);
+  k.ms(lastTickTime);
+  k.ms(bootTime);
+  faultKeyframe(k, faultBoard);
+  irLinkKeyframe(k);
+  tempKeyframe(k);
+  for (uint8_t i = 0; i < tankCount; i++) tanks[i].keyframe(k);
+  if (k.loading) faultSummarize();
+}
+
+const char* resetReasonName(esp_reset_reason_t reason) {
+  switch (reason) {
+    case ESP_RST_POWERON:  return "power-on";
+    case ESP_RST_EXT:      return "external";
+    case ESP_RST_SW:       return "software";
+    case ESP_RST_PANIC:    return "panic";
+    case ESP_RST_INT_WDT:  return "interrupt watchdog";
+    case ESP_RST_TASK_WDT: return "task watchdog";
+    case ESP_RST_WDT:      return "watchdog";
+    case ESP_RST_DEEPSLEEP: return "deep sleep";
+    case ESP_RST_BROWNOUT: return "brownout";
+    default:               return "unknown";
+  }
+}
+
+void printResetDiagnostics() {
+  Serial.print("  Reset reason: ");
+  Serial.println(resetReasonName(bootResetReason));
+  if (bootLastTask < WDT_TASK_COUNT) {
+    Serial.print("  Last handler: ");
+    Serial.println(WATCHDOG_TASKS[bootLastTask].name);
+  }
+  Serial.print("  Warm boots: ");
+  Serial.print(rtcDiag.warmBoots);
+  Serial.print(" (");
+  Serial.print(rtcDiag.warmStreak);
+  Serial.println(" in a row)");
+}
+
+#endif